@@ -0,0 +1,224 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "BinaryFileSink.h"
+#include "BinaryFormat.h"
+
+#include <chrono>
+
+using namespace std;
+
+namespace fair
+{
+
+namespace
+{
+
+template<typename T>
+T ReadRaw(const char*& pos)
+{
+    T value;
+    memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+int64_t ReadSigned(const char*& pos, char size)
+{
+    switch (size) {
+        case '1': return ReadRaw<int8_t>(pos);
+        case '2': return ReadRaw<int16_t>(pos);
+        case '4': return ReadRaw<int32_t>(pos);
+        default:  return ReadRaw<int64_t>(pos);
+    }
+}
+
+uint64_t ReadUnsigned(const char*& pos, char size)
+{
+    switch (size) {
+        case '1': return ReadRaw<uint8_t>(pos);
+        case '2': return ReadRaw<uint16_t>(pos);
+        case '4': return ReadRaw<uint32_t>(pos);
+        default:  return ReadRaw<uint64_t>(pos);
+    }
+}
+
+} // namespace
+
+Logger::BinaryFileSink::BinaryFileSink()
+    : fNextSite(0)
+    , fLastTimestamp(0)
+    , fErrors(0)
+{}
+
+Logger::BinaryFileSink::~BinaryFileSink()
+{
+    Close();
+}
+
+bool Logger::BinaryFileSink::Open(const string& filename)
+{
+    Close();
+
+    fFile.open(filename, fstream::out | fstream::binary | fstream::trunc);
+    if (!fFile.is_open()) {
+        return false;
+    }
+
+    fLastTimestamp = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    fBuffer.append(binlog::Magic, sizeof(binlog::Magic));
+    fBuffer.push_back(static_cast<char>(binlog::Version));
+    binlog::PutString(fBuffer, fProcessName);
+    binlog::PutVarint(fBuffer, fLastTimestamp);
+    WriteOut();
+    return true;
+}
+
+void Logger::BinaryFileSink::Close()
+{
+    if (fFile.is_open()) {
+        WriteOut();
+        fFile.close();
+    }
+    fBuffer.clear();
+    fCallSites.clear();
+    fSites.clear();
+    fNextSite = 0;
+}
+
+bool Logger::BinaryFileSink::Encodable(const char* types)
+{
+    for (const char* t = types + 1; *t != '\0'; t += 2) {
+        if (*t == 'x' || t[1] == '?') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Logger::BinaryFileSink::Write(const LogMetaData& infos, const CallSite* callSite, string_view content, const DeferredArgs* deferred)
+{
+    const int64_t timestamp = static_cast<int64_t>(infos.timestamp) * 1000000 + infos.us.count();
+    string_view format = deferred ? deferred->fFormat : string_view();
+    string_view types = deferred ? string_view(deferred->fTypes) : string_view();
+
+    uint64_t site = SiteId(infos, callSite, format, types);
+
+    fBuffer.push_back(static_cast<char>(binlog::Entry::record));
+    binlog::PutVarint(fBuffer, site);
+    binlog::PutSVarint(fBuffer, timestamp - fLastTimestamp);
+    fBuffer.push_back(static_cast<char>(infos.severity));
+    if (deferred) {
+        EncodeArgs(types, deferred->fArgs);
+    }
+    binlog::PutString(fBuffer, content);
+    fLastTimestamp = timestamp;
+
+    // errors and above go to disk right away, everything else in larger chunks
+    if (infos.severity >= Severity::error || fBuffer.size() >= 65536) {
+        WriteOut();
+    }
+}
+
+uint64_t Logger::BinaryFileSink::SiteId(const LogMetaData& infos, const CallSite* site, string_view format, string_view types)
+{
+    if (site) {
+        auto it = fCallSites.find(site);
+        if (it != fCallSites.end()) {
+            return it->second;
+        }
+        const uint64_t id = AddSite(infos, format, types);
+        fCallSites.emplace(site, id);
+        return id;
+    }
+
+    fKey.clear();
+    fKey.append(infos.file).push_back('\0');
+    fKey.append(infos.line).push_back('\0');
+    fKey.append(infos.func).push_back('\0');
+    fKey.append(format).push_back('\0');
+    fKey.append(types);
+
+    auto it = fSites.find(fKey);
+    if (it != fSites.end()) {
+        return it->second;
+    }
+    const uint64_t id = AddSite(infos, format, types);
+    fSites.emplace(fKey, id);
+    return id;
+}
+
+uint64_t Logger::BinaryFileSink::AddSite(const LogMetaData& infos, string_view format, string_view types)
+{
+    const uint64_t id = fNextSite++;
+    fBuffer.push_back(static_cast<char>(binlog::Entry::site));
+    binlog::PutVarint(fBuffer, id);
+    binlog::PutString(fBuffer, infos.file);
+    binlog::PutString(fBuffer, infos.line);
+    binlog::PutString(fBuffer, infos.func);
+    binlog::PutString(fBuffer, format);
+    binlog::PutString(fBuffer, types);
+    return id;
+}
+
+void Logger::BinaryFileSink::EncodeArgs(string_view types, string_view args)
+{
+    const char* pos = args.data();
+    for (size_t i = 1; i + 1 < types.size(); i += 2) {
+        const char size = types[i + 1];
+        switch (types[i]) {
+            case 's': {
+                size_t len = ReadRaw<size_t>(pos);
+                binlog::PutString(fBuffer, string_view(pos, len));
+                pos += len;
+                break;
+            }
+            case 'i':
+                binlog::PutSVarint(fBuffer, ReadSigned(pos, size));
+                break;
+            case 'u':
+            case 'p':
+                binlog::PutVarint(fBuffer, ReadUnsigned(pos, size));
+                break;
+            case 'b':
+            case 'c':
+                fBuffer.push_back(*pos++);
+                break;
+            case 'f':
+                binlog::PutRaw(fBuffer, ReadRaw<float>(pos));
+                break;
+            case 'd':
+                binlog::PutRaw(fBuffer, ReadRaw<double>(pos));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Logger::BinaryFileSink::WriteOut()
+{
+    if (!fBuffer.empty()) {
+        fFile.write(fBuffer.data(), fBuffer.size());
+        fFile.flush();
+        fBuffer.clear();
+        if (!fFile) {
+            ++fErrors;
+        }
+    }
+}
+
+uint64_t Logger::BinaryFileSink::Errors(bool reset)
+{
+    const uint64_t errors = fErrors;
+    if (reset) {
+        fErrors = 0;
+    }
+    return errors;
+}
+
+} // namespace fair
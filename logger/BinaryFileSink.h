@@ -0,0 +1,64 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_BINARYFILESINK_H
+#define FAIR_LOGGER_BINARYFILESINK_H
+
+#include "Logger.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fair
+{
+
+// Writes lines in the format described in BinaryFormat.h. Not thread-safe, guarded by Logger::fMtx.
+class Logger::BinaryFileSink
+{
+  public:
+    BinaryFileSink();
+    BinaryFileSink(const BinaryFileSink&) = delete;
+    BinaryFileSink& operator=(const BinaryFileSink&) = delete;
+    ~BinaryFileSink();
+
+    bool Open(const std::string& filename);
+    void Close();
+    bool IsOpen() const { return fFile.is_open(); }
+
+    // true if the deferred arguments with the given type tags can be stored in binary form
+    static bool Encodable(const char* types);
+
+    // writes a line, with the arguments in binary form if deferred is given (must be Encodable)
+    void Write(const LogMetaData& infos, const CallSite* site, std::string_view content, const DeferredArgs* deferred);
+    // writes out the buffered lines
+    void Flush() { WriteOut(); }
+    // write outs that failed (lines lost), since the last call if reset is set
+    uint64_t Errors(bool reset = false);
+
+  private:
+    // a call site always has the same format and types, lines without one are looked up by all of them
+    uint64_t SiteId(const LogMetaData& infos, const CallSite* site, std::string_view format, std::string_view types);
+    uint64_t AddSite(const LogMetaData& infos, std::string_view format, std::string_view types);
+    void EncodeArgs(std::string_view types, std::string_view args);
+    void WriteOut();
+
+    std::ofstream fFile;
+    std::string fBuffer;
+    std::string fKey;
+    std::unordered_map<const CallSite*, uint64_t> fCallSites;
+    std::unordered_map<std::string, uint64_t> fSites; // of lines without a call site
+    uint64_t fNextSite;
+    int64_t fLastTimestamp;
+    uint64_t fErrors;
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_BINARYFILESINK_H
@@ -0,0 +1,144 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_BINARYFORMAT_H
+#define FAIR_LOGGER_BINARYFORMAT_H
+
+// Binary log file layout, as written by Logger::InitBinaryFileSink() and read by fairlogger-decode:
+//
+// header: "FLOGBIN\0", u8 version, string process_name, varint start time (µs since epoch)
+// entries, each starting with a u8 tag:
+//   site:   varint id, string file, string line, string func, string format, string types
+//   record: varint site id, svarint time delta (µs, to the previous record), u8 severity,
+//           encoded arguments (if the site has types), string content
+//
+// varint: LEB128, svarint: zigzag encoded varint, string: varint length + bytes.
+// Site types are empty for streamed lines. For deferred lines (LOGPA, LOGFA) they start with
+// '{' (fmt syntax) or '%' (printf syntax), followed by one tag/size pair per argument:
+//   i<n> signed integer (svarint), u<n> unsigned integer (varint), b1 bool (u8), c1 char (u8),
+//   f4 float (4 bytes), d8 double (8 bytes), p<n> pointer (varint), s0 string
+
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace fair
+{
+namespace binlog
+{
+
+constexpr char Magic[8] = {'F', 'L', 'O', 'G', 'B', 'I', 'N', '\0'};
+constexpr uint8_t Version = 1;
+
+enum class Entry : uint8_t
+{
+    site = 1,
+    record = 2
+};
+
+inline void PutVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void PutSVarint(std::string& out, int64_t value)
+{
+    PutVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+inline void PutString(std::string& out, std::string_view str)
+{
+    PutVarint(out, str.size());
+    out.append(str.data(), str.size());
+}
+
+template<typename T>
+inline void PutRaw(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// thrown when the input ends in the middle of an entry (e.g. file of a crashed process)
+struct Truncated : std::runtime_error
+{
+    Truncated() : std::runtime_error("truncated binary log") {}
+};
+
+class Reader
+{
+  public:
+    Reader(const char* begin, const char* end) : fPos(begin), fEnd(end) {}
+
+    bool AtEnd() const { return fPos >= fEnd; }
+    const char* Pos() const { return fPos; }
+
+    uint8_t GetU8()
+    {
+        Require(1);
+        return static_cast<uint8_t>(*fPos++);
+    }
+
+    uint64_t GetVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = GetU8();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("malformed varint in binary log");
+    }
+
+    int64_t GetSVarint()
+    {
+        uint64_t value = GetVarint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::string_view GetString()
+    {
+        uint64_t size = GetVarint();
+        Require(size);
+        std::string_view str(fPos, size);
+        fPos += size;
+        return str;
+    }
+
+    template<typename T>
+    T GetRaw()
+    {
+        Require(sizeof(T));
+        T value;
+        std::memcpy(&value, fPos, sizeof(T));
+        fPos += sizeof(T);
+        return value;
+    }
+
+  private:
+    void Require(uint64_t size) const
+    {
+        if (static_cast<uint64_t>(fEnd - fPos) < size) {
+            throw Truncated();
+        }
+    }
+
+    const char* fPos;
+    const char* fEnd;
+};
+
+} // namespace binlog
+} // namespace fair
+
+#endif // FAIR_LOGGER_BINARYFORMAT_H
@@ -0,0 +1,294 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "CustomSinks.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio> // fprintf
+#include <thread>
+
+using namespace std;
+
+namespace fair
+{
+
+const Logger::CustomSinks::Entry* Logger::CustomSinks::Snapshot::Find(const string& key) const
+{
+    auto it = find_if(fEntries.cbegin(), fEntries.cend(), [&](const Entry& entry) { return entry.fKey == key; });
+    return it == fEntries.cend() ? nullptr : &*it;
+}
+
+Severity Logger::CustomSinks::Snapshot::MinSeverity() const
+{
+    Severity minSeverity = Severity::nolog;
+    for (const auto& entry : fEntries) {
+        if (minSeverity == Severity::nolog) {
+            minSeverity = entry.fSeverity;
+        } else if (entry.fSeverity != Severity::nolog) {
+            minSeverity = std::min(minSeverity, entry.fSeverity);
+        }
+    }
+    return minSeverity;
+}
+
+struct Logger::CustomSinks::ReaderSlots
+{
+    mutex fMtx;
+    vector<ReaderSlot*> fSlots;
+
+    // never destroyed, threads may finish after the static destructors have run
+    static ReaderSlots& Get()
+    {
+        static ReaderSlots* slots = new ReaderSlots;
+        return *slots;
+    }
+};
+
+Logger::CustomSinks::ReaderSlot& Logger::CustomSinks::LocalSlot()
+{
+    struct Registration
+    {
+        Registration()
+        {
+            ReaderSlots& slots = ReaderSlots::Get();
+            lock_guard<mutex> lock(slots.fMtx);
+            slots.fSlots.push_back(&fSlot);
+        }
+        ~Registration()
+        {
+            ReaderSlots& slots = ReaderSlots::Get();
+            lock_guard<mutex> lock(slots.fMtx);
+            slots.fSlots.erase(find(slots.fSlots.begin(), slots.fSlots.end(), &fSlot));
+        }
+        ReaderSlot fSlot;
+    };
+    thread_local Registration registration;
+    return registration.fSlot;
+}
+
+// only the own thread writes its slot (readers may nest), the store orders the count before the load of the snapshot
+Logger::CustomSinks::Reader::Reader(CustomSinks& sinks)
+    : fCounter(LocalSlot().fCounts[sinks.fEpoch.load() & 1])
+{
+    fCounter.store(fCounter.load(memory_order_relaxed) + 1);
+    fSnapshot = sinks.fCurrent.load();
+}
+
+Logger::CustomSinks::Reader::~Reader()
+{
+    fCounter.store(fCounter.load(memory_order_relaxed) - 1, memory_order_release);
+}
+
+unique_ptr<const Logger::CustomSinks::Snapshot> Logger::CustomSinks::Publish(vector<Entry> entries)
+{
+    unique_ptr<Snapshot> next;
+    if (!entries.empty()) {
+        next = make_unique<Snapshot>();
+        next->fEntries = std::move(entries);
+        for (size_t s = 0; s < next->fPlan.size(); ++s) {
+            for (const auto& entry : next->fEntries) {
+                if (LoggingCustom(static_cast<Severity>(s), entry.fSeverity)) {
+                    next->fPlan[s].push_back(entry.fSink.get());
+                }
+            }
+        }
+    }
+
+    return unique_ptr<const Snapshot>(fCurrent.exchange(next.release()));
+}
+
+void Logger::CustomSinks::Retire(unique_ptr<const Snapshot> previous)
+{
+    if (previous) {
+        Synchronize();
+    }
+}
+
+void Logger::CustomSinks::Synchronize()
+{
+    // Readers count themselves in the slot of the epoch they started in. Flipping the epoch twice and waiting for
+    // each slot to drain covers readers that started before the call, however long ago that was.
+    ReaderSlots& slots = ReaderSlots::Get();
+    for (int i = 0; i < 2; ++i) {
+        const unsigned parity = fEpoch.fetch_add(1) & 1;
+        while (true) {
+            {
+                lock_guard<mutex> lock(slots.fMtx);
+                if (none_of(slots.fSlots.cbegin(), slots.fSlots.cend(), [&](const ReaderSlot* slot) { return slot->fCounts[parity].load() > 0; })) {
+                    break;
+                }
+            }
+            this_thread::yield();
+        }
+    }
+}
+
+void Logger::CustomSinks::Call(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, const string& content)
+{
+    lock_guard<mutex> lock(sink.fMtx);
+    Written(sink);
+    try {
+        if (sink.fViewFunc) {
+            sink.fViewFunc(content, infos);
+        } else if (sink.fBatchFunc) {
+            Append(sink, infos, site, content);
+        } else {
+            sink.fFunc(content, infos);
+        }
+    } catch (...) {
+        Failed(sink);
+        throw;
+    }
+}
+
+
+void Logger::CustomSinks::Send(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, const string& content)
+{
+    if (SinkWorker* worker = sink.fWorker.load(memory_order_acquire)) {
+        worker->Push(infos, site, content);
+    } else {
+        Call(sink, infos, site, content);
+    }
+}
+
+struct Logger::CustomSinks::BatchTimer
+{
+    mutex fMtx;
+    condition_variable fWakeUp;
+    bool fStop = false;
+    bool fNewBatch = false; // a batch was started since the last check
+    thread fThread;
+};
+
+void Logger::CustomSinks::Append(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, string_view content)
+{
+    const bool first = sink.fBatch.empty();
+    CustomSinkRecord& record = sink.fBatch.emplace_back();
+    record.content.assign(content.data(), content.size());
+    record.metadata = infos;
+    if (!site) {
+        // rebound to the copy in Deliver(), the records may still move until then
+        record.origin.reserve(infos.file.size() + infos.line.size() + infos.func.size());
+        record.origin.append(infos.file).append(infos.line).append(infos.func);
+    }
+
+    if (sink.fBatch.size() >= sink.fMaxRecords || infos.severity == Severity::fatal) {
+        Deliver(sink);
+    } else if (first) {
+        sink.fDeadline = chrono::steady_clock::now() + sink.fMaxDelay;
+        // one wake up per batch, so that the timer can wait for the earliest deadline
+        BatchTimer* timer = fTimer.load();
+        if (timer) {
+            {
+                lock_guard<mutex> lock(timer->fMtx);
+                timer->fNewBatch = true;
+            }
+            timer->fWakeUp.notify_one();
+        }
+    }
+}
+
+void Logger::CustomSinks::Deliver(Sink& sink)
+{
+    if (sink.fBatch.empty()) {
+        return;
+    }
+    for (auto& record : sink.fBatch) {
+        if (!record.origin.empty()) {
+            string_view origin(record.origin);
+            const size_t fileLen = record.metadata.file.size();
+            const size_t lineLen = record.metadata.line.size();
+            record.metadata.file = origin.substr(0, fileLen);
+            record.metadata.line = origin.substr(fileLen, lineLen);
+            record.metadata.func = origin.substr(fileLen + lineLen);
+        }
+    }
+    try {
+        sink.fBatchFunc(sink.fBatch);
+    } catch (const exception& e) {
+        Failed(sink);
+        fprintf(stderr, "Logger: exception in batch sink: %s\n", e.what());
+    }
+    // keeps the capacity for the next batch
+    sink.fBatch.clear();
+}
+
+chrono::steady_clock::time_point Logger::CustomSinks::FlushBatches(bool all)
+{
+    // the sinks are collected first, so that no snapshot is held while the batches are handed over
+    vector<shared_ptr<Sink>> batchSinks;
+    {
+        Reader reader(*this);
+        const Snapshot* sinks = reader.Get();
+        if (sinks) {
+            for (const auto& entry : sinks->fEntries) {
+                if (entry.fSink->fBatchFunc) {
+                    batchSinks.push_back(entry.fSink);
+                }
+            }
+        }
+    }
+
+    auto next = chrono::steady_clock::time_point::max();
+    const auto now = chrono::steady_clock::now();
+    for (const auto& sink : batchSinks) {
+        lock_guard<mutex> lock(sink->fMtx);
+        if (sink->fBatch.empty()) {
+            continue;
+        }
+        if (all || sink->fDeadline <= now) {
+            Deliver(*sink);
+        } else {
+            next = std::min(next, sink->fDeadline);
+        }
+    }
+    return next;
+}
+
+void Logger::CustomSinks::StartBatchTimer()
+{
+    if (fTimer.load()) {
+        return;
+    }
+    auto timer = new BatchTimer();
+    timer->fThread = thread([this, timer]() {
+        unique_lock<mutex> lock(timer->fMtx);
+        while (!timer->fStop) {
+            timer->fNewBatch = false;
+            lock.unlock();
+            const auto next = FlushBatches(false);
+            lock.lock();
+            if (timer->fStop) {
+                break;
+            }
+            // a batch started in the meantime may have an earlier deadline
+            auto woken = [&]() { return timer->fStop || timer->fNewBatch; };
+            if (next == chrono::steady_clock::time_point::max()) {
+                timer->fWakeUp.wait(lock, woken);
+            } else {
+                timer->fWakeUp.wait_until(lock, next, woken);
+            }
+        }
+    });
+    fTimer.store(timer);
+}
+
+void Logger::CustomSinks::StopBatchTimer()
+{
+    unique_ptr<BatchTimer> timer(fTimer.exchange(nullptr));
+    if (timer) {
+        {
+            lock_guard<mutex> lock(timer->fMtx);
+            timer->fStop = true;
+        }
+        timer->fWakeUp.notify_one();
+        timer->fThread.join();
+    }
+}
+
+} // namespace fair
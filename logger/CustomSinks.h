@@ -0,0 +1,169 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_CUSTOMSINKS_H
+#define FAIR_LOGGER_CUSTOMSINKS_H
+
+#include "Logger.h"
+#include "RepeatFilter.h"
+#include "StatsCollector.h"
+#include "SinkWorker.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fair
+{
+
+// shared by all snapshots the sink is part of, calls to one sink are serialized by its own mutex
+struct Logger::CustomSink
+{
+    using Func = std::function<void(const std::string& content, const LogMetaData& metadata)>;
+    using ViewFunc = std::function<void(std::string_view content, const ExtendedLogMetaData& metadata)>;
+    using BatchFunc = std::function<void(const std::vector<CustomSinkRecord>& records)>;
+
+    explicit CustomSink(Func func) : fFunc(std::move(func)) {}
+    explicit CustomSink(ViewFunc func) : fViewFunc(std::move(func)) {}
+    CustomSink(BatchFunc func, size_t maxRecords, std::chrono::microseconds maxDelay)
+        : fBatchFunc(std::move(func))
+        , fMaxRecords(maxRecords)
+        , fMaxDelay(maxDelay)
+    {}
+    CustomSink(const CustomSink&) = delete;
+    CustomSink& operator=(const CustomSink&) = delete;
+    ~CustomSink()
+    {
+        delete fWorker.load();
+        fStats.ReleaseSlot(fStatsSlot);
+    }
+
+    // exactly one of the three is set
+    Func fFunc;           // original signature, gets a std::string copy of the content
+    ViewFunc fViewFunc;   // std::string_view signature
+    BatchFunc fBatchFunc; // batches of records
+
+    // batching, guarded by fMtx
+    size_t fMaxRecords = 0;
+    std::chrono::microseconds fMaxDelay{ 0 };
+    std::vector<CustomSinkRecord> fBatch;
+    std::chrono::steady_clock::time_point fDeadline; // of the pending batch
+
+    // own queue and thread if set (see Logger::SetCustomSinkQueue), replaced only by Logger::fMtx holders
+    std::atomic<SinkWorker*> fWorker{ nullptr };
+    std::atomic<uint64_t> fDrops{ 0 };
+
+    RepeatFilter fRepeats;
+
+    // of the per-thread counters of lines handed to the sink and calls that threw (see Logger::GetStats)
+    const size_t fStatsSlot = fStats.AcquireSlot();
+
+    std::mutex fMtx;
+};
+
+// The set of custom sinks is published as an immutable snapshot. Logging threads read it without a global lock,
+// changes build a new snapshot, swap it in and free the old one once no reader can still see it (RCU style).
+// Readers count themselves in a slot of their own thread, so reading writes no cache line shared with other threads.
+class Logger::CustomSinks
+{
+  public:
+    using Sink = Logger::CustomSink;
+
+    struct Entry
+    {
+        std::string fKey;
+        Severity fSeverity;
+        std::shared_ptr<Sink> fSink;
+    };
+
+    struct Snapshot
+    {
+        std::vector<Entry> fEntries;
+        // sinks receiving a line, per Severity
+        std::array<std::vector<Sink*>, 16> fPlan;
+
+        const Entry* Find(const std::string& key) const;
+        // lowest severity over all sinks (nolog if none)
+        Severity MinSeverity() const;
+    };
+
+    // read access for the lifetime of the object
+    class Reader
+    {
+      public:
+        explicit Reader(CustomSinks& sinks);
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader();
+
+        // nullptr if there are no custom sinks
+        const Snapshot* Get() const { return fSnapshot; }
+
+      private:
+        std::atomic<int>& fCounter;
+        const Snapshot* fSnapshot;
+    };
+
+    constexpr CustomSinks() : fCurrent(nullptr), fEpoch(0), fTimer(nullptr) {}
+    CustomSinks(const CustomSinks&) = delete;
+    CustomSinks& operator=(const CustomSinks&) = delete;
+
+    // writers must be serialized by the caller (Logger::fMtx) and must not be called from within a sink
+    const Snapshot* Current() const { return fCurrent.load(); }
+    // computes the dispatch plan and publishes the entries, returns the replaced snapshot to be passed to Retire()
+    std::unique_ptr<const Snapshot> Publish(std::vector<Entry> entries);
+    // waits until no reader can still see the snapshot and frees it, to be called without Logger::fMtx as a sink may log
+    void Retire(std::unique_ptr<const Snapshot> previous);
+    // waits until no reader can still see what was replaced before the call
+    void Synchronize();
+
+    // hands a queued line to the sink, on the thread of its worker
+    void Call(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, const std::string& content);
+    // hands the line to the queue of the sink if it has one, otherwise to the sink
+    void Send(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, const std::string& content);
+
+    // Adds a line to the batch of the sink (the caller holds sink.fMtx) and hands the batch over if it is full or the
+    // line is fatal. Without a call site, file, line and function are copied into the record.
+    void Append(Sink& sink, const ExtendedLogMetaData& infos, const CallSite* site, std::string_view content);
+    // hands the pending batch to the sink, the caller holds sink.fMtx
+    static void Deliver(Sink& sink);
+    // count a line handed to the sink or a call that threw, in the counters of the calling thread
+    static void Written(Sink& sink) { fStats.CustomWritten(sink.fStatsSlot); }
+    static void Failed(Sink& sink) { fStats.CustomFailed(sink.fStatsSlot); }
+    // Hands over the batches whose delay has passed (all pending batches if all is set). Returns the earliest deadline
+    // of the batches still pending.
+    std::chrono::steady_clock::time_point FlushBatches(bool all);
+
+    // the timer hands over batches once their delay has passed, it is started with the first batch sink
+    void StartBatchTimer();
+    void StopBatchTimer();
+
+  private:
+    struct BatchTimer;
+    // the reader counts of one thread, per epoch parity
+    struct alignas(64) ReaderSlot
+    {
+        std::array<std::atomic<int>, 2> fCounts{};
+    };
+    struct ReaderSlots;
+
+    static ReaderSlot& LocalSlot();
+
+    std::atomic<const Snapshot*> fCurrent;
+    std::atomic<unsigned> fEpoch;
+    std::atomic<BatchTimer*> fTimer;
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_CUSTOMSINKS_H
@@ -0,0 +1,533 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "FdWriter.h"
+
+#include <algorithm> // min, sort
+#include <cerrno>
+#include <cstdio> // rename, remove
+#include <cstdlib> // strtoul
+#include <deque>
+#include <tuple>
+#include <vector>
+
+#include <dirent.h> // opendir
+#include <fcntl.h> // open
+#ifdef FAIRLOGGER_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include <sys/stat.h> // fstat
+#include <sys/uio.h> // writev
+#include <unistd.h> // close
+
+using namespace std;
+
+namespace fair
+{
+
+namespace
+{
+
+// writes path + ".gz", true on success
+bool Compress(const string& path)
+{
+#ifdef FAIRLOGGER_WITH_ZLIB
+    const int in = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    const string target = path + ".gz";
+    gzFile out = gzopen(target.c_str(), "wb6");
+    bool ok = out != nullptr;
+    vector<char> chunk(256 * 1024);
+    while (ok) {
+        const ssize_t n = read(in, chunk.data(), chunk.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = gzwrite(out, chunk.data(), static_cast<unsigned>(n)) == n;
+    }
+    if (out != nullptr && gzclose(out) != Z_OK) {
+        ok = false;
+    }
+    close(in);
+    if (!ok) {
+        remove(target.c_str());
+    }
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// files of earlier rotations of path (path.<YYYY-MM-DD_HH_MM_SS>.<n>[.gz]), oldest first, sets last to the highest n
+vector<string> RotatedFiles(const string& path, unsigned& last)
+{
+    const size_t slash = path.rfind('/');
+    const string dir = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    const string prefix = (slash == string::npos ? path : path.substr(slash + 1)) + ".";
+    const string timestamp = "0000-00-00_00_00_00";
+
+    vector<tuple<string, unsigned long, string>> found; // timestamp, n, path
+    last = 0;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        return {};
+    }
+    while (const dirent* entry = readdir(d)) {
+        const string name = entry->d_name;
+        if (name.size() < prefix.size() + timestamp.size() + 2 || name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        const string stamp = name.substr(prefix.size(), timestamp.size());
+        bool valid = name[prefix.size() + timestamp.size()] == '.';
+        for (size_t i = 0; i < timestamp.size() && valid; ++i) {
+            valid = timestamp[i] == '0' ? (stamp[i] >= '0' && stamp[i] <= '9') : stamp[i] == timestamp[i];
+        }
+        const char* n = name.c_str() + prefix.size() + timestamp.size() + 1;
+        char* end = nullptr;
+        const unsigned long rotation = strtoul(n, &end, 10);
+        if (!valid || end == n || *n < '0' || *n > '9' || !(*end == '\0' || string(end) == ".gz")) {
+            continue;
+        }
+        found.emplace_back(stamp, rotation, path.substr(0, slash == string::npos ? 0 : slash + 1) + name);
+        last = max(last, static_cast<unsigned>(rotation));
+    }
+    closedir(d);
+
+    sort(found.begin(), found.end());
+    vector<string> files;
+    for (auto& f : found) {
+        files.push_back(std::move(get<2>(f)));
+    }
+    return files;
+}
+
+} // namespace
+
+struct Logger::FdWriter::Compressor
+{
+#ifdef FAIRLOGGER_WITH_ZLIB
+    Compressor()
+        : fStream()
+    {
+        // window bits 15 + 16: gzip header and trailer, so that concatenated members form a valid .gz file
+        fReady = deflateInit2(&fStream, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~Compressor()
+    {
+        if (fReady) {
+            deflateEnd(&fStream);
+        }
+    }
+
+    // compresses the parts into one gzip member in out, false on failure
+    bool Frame(const iovec* parts, int count, vector<char>& out)
+    {
+        if (!fReady || deflateReset(&fStream) != Z_OK) {
+            return false;
+        }
+        size_t total = 0;
+        for (int i = 0; i < count; ++i) {
+            total += parts[i].iov_len;
+        }
+        // with deflateBound() bytes of output space a single deflate() call consumes all input
+        out.resize(deflateBound(&fStream, total));
+        fStream.next_out = reinterpret_cast<Bytef*>(out.data());
+        fStream.avail_out = static_cast<uInt>(out.size());
+        int ret = Z_OK;
+        for (int i = 0; i < count && ret == Z_OK; ++i) {
+            fStream.next_in = static_cast<Bytef*>(parts[i].iov_base);
+            fStream.avail_in = static_cast<uInt>(parts[i].iov_len);
+            ret = deflate(&fStream, i == count - 1 ? Z_FINISH : Z_NO_FLUSH);
+        }
+        if (ret != Z_STREAM_END) {
+            return false;
+        }
+        out.resize(out.size() - fStream.avail_out);
+        return true;
+    }
+
+    z_stream fStream;
+    bool fReady;
+#else
+    bool Frame(const iovec*, int, vector<char>&) { return false; }
+#endif
+};
+
+struct Logger::FdWriter::Archiver
+{
+    struct Job
+    {
+        int fFd;
+        string fPath;
+        bool fCompress;
+        unsigned fKeep;
+        optional<vector<string>> fLeftovers; // rotated files of a newly opened path, replace the archived ones
+    };
+
+    Archiver()
+        : fStop(false)
+    {
+        fThread = thread(&Archiver::Run, this);
+    }
+
+    // finishes all jobs
+    ~Archiver()
+    {
+        {
+            lock_guard<mutex> lock(fMtx);
+            fStop = true;
+        }
+        fWakeUp.notify_one();
+        fThread.join();
+    }
+
+    void Add(Job job)
+    {
+        {
+            lock_guard<mutex> lock(fMtx);
+            fJobs.push_back(std::move(job));
+        }
+        fWakeUp.notify_one();
+    }
+
+    void Run()
+    {
+        unique_lock<mutex> lock(fMtx);
+        while (true) {
+            fWakeUp.wait(lock, [&]() { return fStop || !fJobs.empty(); });
+            if (fJobs.empty()) {
+                break;
+            }
+            Job job = std::move(fJobs.front());
+            fJobs.pop_front();
+            lock.unlock();
+
+            close(job.fFd);
+            if (job.fLeftovers) {
+                fArchived.assign(job.fLeftovers->begin(), job.fLeftovers->end());
+            }
+            string archived = job.fPath;
+            if (job.fCompress && Compress(job.fPath)) {
+                remove(job.fPath.c_str());
+                archived += ".gz";
+            }
+            fArchived.push_back(archived);
+            while (job.fKeep > 0 && fArchived.size() > job.fKeep) {
+                remove(fArchived.front().c_str());
+                fArchived.pop_front();
+            }
+
+            lock.lock();
+        }
+    }
+
+    bool fStop;
+    deque<Job> fJobs;
+    deque<string> fArchived; // rotated files still on disk, oldest first (only used by the thread)
+    mutex fMtx;
+    condition_variable fWakeUp;
+    thread fThread;
+};
+
+Logger::FdWriter::FdWriter(int fd)
+    : fOwned(false)
+    , fFd(fd)
+    , fPolicy()
+    , fActive()
+    , fBuffered(false)
+    , fStop(false)
+    , fRotation()
+    , fSize(0)
+    , fOpened(0)
+    , fRotations(0)
+    , fCompressNext(false)
+    , fErrors(0)
+{}
+
+Logger::FdWriter::FdWriter()
+    : fOwned(true)
+    , fFd(-1)
+    , fPolicy()
+    , fActive()
+    , fBuffered(false)
+    , fStop(false)
+    , fRotation()
+    , fSize(0)
+    , fOpened(0)
+    , fRotations(0)
+    , fCompressNext(false)
+    , fErrors(0)
+{}
+
+Logger::FdWriter::~FdWriter()
+{
+    {
+        lock_guard<mutex> lock(fMtx);
+        fStop = true;
+    }
+    fWakeUp.notify_one();
+    if (fTimer.joinable()) {
+        fTimer.join();
+    }
+    if (fOwned) {
+        Close();
+    } else {
+        Flush();
+    }
+    // waits for the rotated files still being compressed
+    fArchiver.reset();
+}
+
+bool Logger::FdWriter::Open(const string& filename)
+{
+    const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    unsigned lastRotation = 0;
+    vector<string> leftovers = RotatedFiles(filename, lastRotation);
+
+    lock_guard<mutex> lock(fMtx);
+    WriteOut(string_view());
+    if (fFd >= 0) {
+        close(fFd);
+    }
+    fFd = fd;
+    fPath = filename;
+    struct stat st;
+    fSize = (fFd >= 0 && fstat(fFd, &st) == 0) ? st.st_size : 0;
+    fOpened = time(nullptr);
+    fLeftovers = std::move(leftovers);
+    fRotations = max(fRotations, lastRotation); // new names must not overwrite the leftovers
+    if (!fCompressNext) {
+        fCompressor.reset();
+    } else if (!fCompressor) {
+        fCompressor = make_unique<Compressor>();
+    }
+    UpdateBuffered();
+    return fFd >= 0;
+}
+
+void Logger::FdWriter::Close()
+{
+    lock_guard<mutex> lock(fMtx);
+    WriteOut(string_view());
+    if (fFd >= 0) {
+        close(fFd);
+        fFd = -1;
+    }
+}
+
+bool Logger::FdWriter::IsOpen()
+{
+    lock_guard<mutex> lock(fMtx);
+    return fFd >= 0;
+}
+
+void Logger::FdWriter::SetPolicy(const FlushPolicy& policy)
+{
+    lock_guard<mutex> lock(fMtx);
+    WriteOut(string_view());
+    fPolicy = policy;
+    UpdateBuffered();
+    fWakeUp.notify_one();
+}
+
+void Logger::FdWriter::SetRotation(const RotationPolicy& policy)
+{
+    lock_guard<mutex> lock(fMtx);
+    fRotation = policy;
+}
+
+bool Logger::FdWriter::SetCompression(bool compress)
+{
+#ifdef FAIRLOGGER_WITH_ZLIB
+    lock_guard<mutex> lock(fMtx);
+    fCompressNext = compress;
+    return true;
+#else
+    return !compress;
+#endif
+}
+
+bool Logger::FdWriter::GetCompression()
+{
+    lock_guard<mutex> lock(fMtx);
+    return fCompressNext;
+}
+
+void Logger::FdWriter::RotateIfDue(size_t size)
+{
+    if (!fOwned || fFd < 0 || fSize == 0 || (fRotation.maxBytes == 0 && fRotation.interval.count() == 0)) {
+        return;
+    }
+    const time_t now = time(nullptr);
+    const bool full = fRotation.maxBytes > 0 && fSize + size > fRotation.maxBytes;
+    const bool old = fRotation.interval.count() > 0 && now - fOpened >= fRotation.interval.count();
+    if (!full && !old) {
+        return;
+    }
+
+    // only the rename and the open happen here, closing and compressing is left to the archiver thread
+    char timestamp[32];
+    tm local;
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H_%M_%S", localtime_r(&now, &local));
+    const string rotated = fPath + "." + timestamp + "." + to_string(++fRotations);
+    if (rename(fPath.c_str(), rotated.c_str()) != 0) {
+        return; // keep writing to the current file
+    }
+    const int fd = open(fPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        rename(rotated.c_str(), fPath.c_str());
+        return;
+    }
+
+    if (!fArchiver) {
+        fArchiver = make_unique<Archiver>();
+    }
+    // a compressed stream is already a valid .gz file
+    fArchiver->Add({ fFd, rotated, fRotation.compress && !fCompressor, fRotation.keep, std::move(fLeftovers) });
+    fLeftovers.reset();
+    fFd = fd;
+    fSize = 0;
+    fOpened = now;
+}
+
+void Logger::FdWriter::UpdateBuffered()
+{
+    struct stat st;
+    const bool regular = fFd >= 0 && fstat(fFd, &st) == 0 && S_ISREG(st.st_mode);
+    fActive = (fCompressor && fPolicy.severity == Severity::trace) ? FramePolicy() : fPolicy;
+    fBuffered = regular && fActive.severity > Severity::trace;
+    if (fBuffered && fActive.interval.count() > 0 && !fTimer.joinable()) {
+        fTimer = thread(&FdWriter::RunTimer, this);
+    }
+}
+
+Logger::FlushPolicy Logger::FdWriter::FramePolicy()
+{
+    FlushPolicy policy;
+    policy.severity = Severity::error;
+    policy.interval = chrono::seconds(1);
+    policy.bufferSize = 64 * 1024;
+    return policy;
+}
+
+void Logger::FdWriter::Write(Severity severity, string_view line)
+{
+    if (!fOwned && !fBuffered.load(memory_order_relaxed)) {
+        // a single write(2) per line: no lock needed, lines up to PIPE_BUF reach a pipe in one piece
+        iovec iov{ const_cast<char*>(line.data()), line.size() };
+        if (!WriteAll(fFd, &iov, 1)) {
+            fErrors.fetch_add(1, memory_order_relaxed);
+        }
+        return;
+    }
+
+    lock_guard<mutex> lock(fMtx);
+    if (fFd < 0) {
+        return;
+    }
+    // error and above are never held back, whatever the policy says
+    if (!fBuffered || severity >= min(fActive.severity, Severity::error) || fBuffer.size() + line.size() > fActive.bufferSize) {
+        WriteOut(line);
+        return;
+    }
+    if (fBuffer.empty()) {
+        fFirstBuffered = chrono::steady_clock::now();
+        fWakeUp.notify_one();
+    }
+    fBuffer.append(line);
+}
+
+void Logger::FdWriter::Flush()
+{
+    lock_guard<mutex> lock(fMtx);
+    WriteOut(string_view());
+}
+
+void Logger::FdWriter::WriteOut(string_view line)
+{
+    iovec iov[2];
+    int count = 0;
+    if (!fBuffer.empty()) {
+        iov[count++] = { fBuffer.data(), fBuffer.size() };
+    }
+    if (!line.empty()) {
+        iov[count++] = { const_cast<char*>(line.data()), line.size() };
+    }
+    size_t size = fBuffer.size() + line.size();
+    if (count > 0 && fCompressor) {
+        // every write out is a complete gzip member, a crash loses at most the member being written
+        if (fCompressor->Frame(iov, count, fFrame)) {
+            iov[0] = { fFrame.data(), fFrame.size() };
+            count = 1;
+            size = fFrame.size();
+        } else {
+            count = 0; // plain text would corrupt the stream
+            fErrors.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+    RotateIfDue(size);
+    if (count > 0 && fFd >= 0) {
+        if (!WriteAll(fFd, iov, count)) {
+            fErrors.fetch_add(1, memory_order_relaxed);
+        }
+        fSize += size;
+    }
+    fBuffer.clear();
+}
+
+bool Logger::FdWriter::WriteAll(int fd, iovec* iov, int count)
+{
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false; // nothing sensible to do, the line is lost
+        }
+        // continue after a partial write
+        while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+void Logger::FdWriter::RunTimer()
+{
+    unique_lock<mutex> lock(fMtx);
+    while (!fStop) {
+        if (!fBuffered || fActive.interval.count() == 0 || fBuffer.empty()) {
+            fWakeUp.wait(lock);
+            continue;
+        }
+        const auto deadline = fFirstBuffered + fActive.interval;
+        if (chrono::steady_clock::now() >= deadline) {
+            WriteOut(string_view());
+        } else {
+            fWakeUp.wait_until(lock, deadline);
+        }
+    }
+}
+
+} // namespace fair
@@ -0,0 +1,114 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_FDWRITER_H
+#define FAIR_LOGGER_FDWRITER_H
+
+#include "Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct iovec;
+
+namespace fair
+{
+
+// Writes finished lines to a file descriptor with write(2)/writev(2), either one call per line or buffered according
+// to a FlushPolicy. Buffering applies only if the descriptor refers to a regular file. Buffered lines are appended to
+// one large buffer, which is written out together with the line that triggers the flush in a single writev(2).
+// Opened files can instead be written as a series of independent gzip members, one per write out. Without a buffering
+// policy, compressed files are written out according to FramePolicy(), as a member per line would not compress.
+class Logger::FdWriter
+{
+  public:
+    // writes to the given descriptor, which stays open
+    explicit FdWriter(int fd);
+    // writes to files opened with Open()
+    FdWriter();
+    FdWriter(const FdWriter&) = delete;
+    FdWriter& operator=(const FdWriter&) = delete;
+    // writes out buffered lines (and closes the file)
+    ~FdWriter();
+
+    // appends to the given file, closing the previous one
+    bool Open(const std::string& filename);
+    void Close();
+    bool IsOpen();
+
+    void SetPolicy(const FlushPolicy& policy);
+    // rotation of files opened with Open()
+    void SetRotation(const RotationPolicy& policy);
+    // gzip compression of files opened afterwards, returns false if built without zlib
+    bool SetCompression(bool compress);
+    bool GetCompression();
+
+    // writes the line (including its newline) or buffers it, thread-safe
+    void Write(Severity severity, std::string_view line);
+    // writes out buffered lines
+    void Flush();
+    // write outs that failed (lines lost), since the last call if reset is set
+    uint64_t Errors(bool reset = false) { return reset ? fErrors.exchange(0, std::memory_order_relaxed) : fErrors.load(std::memory_order_relaxed); }
+
+  private:
+    // writes the buffer and the line with a single writev(2), the caller holds fMtx
+    void WriteOut(std::string_view line);
+    // false if the data could not be written
+    static bool WriteAll(int fd, iovec* iov, int count);
+    // the caller holds fMtx
+    void UpdateBuffered();
+    // error and above end a frame right away, other lines after at most a second or 64 KB
+    static FlushPolicy FramePolicy();
+    void RunTimer();
+    // switches to a new file if the rotation policy asks for it before size more bytes are written, the caller holds fMtx
+    void RotateIfDue(size_t size);
+
+    // closes, compresses and prunes rotated files on its own thread
+    struct Archiver;
+    // turns a write out into a complete gzip member
+    struct Compressor;
+
+    // descriptors of opened files can change, the ones given to the constructor cannot (no locking needed)
+    const bool fOwned;
+    int fFd;
+    FlushPolicy fPolicy;
+    FlushPolicy fActive; // fPolicy, or FramePolicy() for a compressed file without buffering
+    std::atomic<bool> fBuffered;
+    std::string fBuffer;
+    std::chrono::steady_clock::time_point fFirstBuffered; // time of the oldest buffered line
+    bool fStop;
+    std::mutex fMtx;
+    std::condition_variable fWakeUp;
+    std::thread fTimer; // writes out buffered lines after FlushPolicy::interval
+
+    std::string fPath;
+    RotationPolicy fRotation;
+    size_t fSize;        // bytes in the current file
+    std::time_t fOpened; // when the current file was started
+    unsigned fRotations;
+    std::optional<std::vector<std::string>> fLeftovers; // rotated files of fPath found by Open(), until the next rotation
+    std::unique_ptr<Archiver> fArchiver; // started with the first rotation
+
+    bool fCompressNext;                      // applies to the next Open()
+    std::unique_ptr<Compressor> fCompressor; // set while the current file is compressed
+    std::vector<char> fFrame;                // output of fCompressor
+
+    std::atomic<uint64_t> fErrors;
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_FDWRITER_H
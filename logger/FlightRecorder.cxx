@@ -0,0 +1,172 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <iterator> // back_inserter
+#include <memory>
+
+using namespace std;
+
+namespace fair
+{
+
+struct Logger::FlightRecorder::Ring
+{
+    mutex fMtx;
+    vector<Item> fItems; // fCount items before fNext (circularly), oldest first
+    size_t fNext = 0;
+    size_t fCount = 0;
+};
+
+struct Logger::FlightRecorder::Registration
+{
+    explicit Registration(FlightRecorder& recorder)
+        : fRecorder(recorder)
+        , fRing(make_unique<Ring>())
+    {
+        lock_guard<mutex> lock(fRecorder.fMtx);
+        fRecorder.fRings.push_back(fRing.get());
+    }
+
+    ~Registration()
+    {
+        if (!Logger::fIsDestructed) {
+            fRecorder.Unregister(fRing.get());
+        }
+    }
+
+    FlightRecorder& fRecorder;
+    unique_ptr<Ring> fRing;
+};
+
+Logger::FlightRecorder::FlightRecorder()
+    : fRecordSeverity(Severity::nolog)
+    , fTriggerSeverity(Severity::error)
+    , fCapacity(0)
+{}
+
+Logger::FlightRecorder::~FlightRecorder() = default;
+
+void Logger::FlightRecorder::Configure(Severity recordSeverity, Severity triggerSeverity, size_t capacity)
+{
+    lock_guard<mutex> lock(fMtx);
+    fCapacity = capacity;
+    fTriggerSeverity = triggerSeverity;
+    fRecordSeverity = capacity > 0 ? recordSeverity : Severity::nolog;
+    if (fRecordSeverity == Severity::nolog) {
+        // free the memory of the rings, they are sized again by the next recorded line
+        fFinished.clear();
+        for (Ring* ring : fRings) {
+            lock_guard<mutex> ringLock(ring->fMtx);
+            vector<Item>().swap(ring->fItems);
+            ring->fNext = 0;
+            ring->fCount = 0;
+        }
+    }
+}
+
+Logger::FlightRecorder::Ring& Logger::FlightRecorder::LocalRing()
+{
+    thread_local Registration registration(*this);
+    return *registration.fRing;
+}
+
+void Logger::FlightRecorder::Unregister(Ring* ring)
+{
+    lock_guard<mutex> lock(fMtx);
+    fRings.erase(remove(fRings.begin(), fRings.end(), ring), fRings.end());
+
+    // the context of a finished thread can still matter for an error reported by another one
+    lock_guard<mutex> ringLock(ring->fMtx);
+    const size_t size = ring->fItems.size();
+    for (size_t i = 0; i < ring->fCount; ++i) {
+        fFinished.push_back(std::move(ring->fItems[(ring->fNext + size - ring->fCount + i) % size]));
+    }
+    while (fFinished.size() > fCapacity.load(memory_order_relaxed)) {
+        fFinished.pop_front();
+    }
+}
+
+void Logger::FlightRecorder::Record(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, string_view content)
+{
+    Ring& ring = LocalRing();
+    lock_guard<mutex> lock(ring.fMtx);
+    const size_t capacity = fCapacity.load(memory_order_relaxed);
+    if (capacity == 0) {
+        return;
+    }
+    if (ring.fItems.size() != capacity) {
+        ring.fItems.clear();
+        ring.fItems.resize(capacity);
+        ring.fNext = 0;
+        ring.fCount = 0;
+    }
+
+    // the strings of the overwritten item keep their capacity, a recorder that runs for a while does not allocate
+    Item& item = ring.fItems[ring.fNext];
+    item.fRecord.content.assign(content.data(), content.size());
+    item.fRecord.metadata = infos;
+    item.fRecord.origin.clear();
+    if (!site) {
+        item.fRecord.origin.append(infos.file).append(infos.line).append(infos.func);
+    }
+    item.fSite = site;
+    item.fVerbosity = verbosity;
+    ring.fNext = (ring.fNext + 1) % capacity;
+    ring.fCount = min(ring.fCount + 1, capacity);
+}
+
+vector<Logger::FlightRecorder::Item> Logger::FlightRecorder::Take(time_t timestamp, chrono::microseconds us)
+{
+    auto after = [&](const Item& item) {
+        const LogMetaData& m = item.fRecord.metadata;
+        return m.timestamp > timestamp || (m.timestamp == timestamp && m.us > us);
+    };
+
+    vector<Item> items;
+    {
+        lock_guard<mutex> lock(fMtx);
+        auto finished = stable_partition(fFinished.begin(), fFinished.end(), after);
+        move(finished, fFinished.end(), back_inserter(items));
+        fFinished.erase(finished, fFinished.end());
+        for (Ring* ring : fRings) {
+            lock_guard<mutex> ringLock(ring->fMtx);
+            const size_t size = ring->fItems.size();
+            // the lines of a ring are in time order, the ones after the given time stay for the next trigger
+            size_t pos = (ring->fNext + size - ring->fCount) % max<size_t>(size, 1);
+            while (ring->fCount > 0 && !after(ring->fItems[pos])) {
+                items.push_back(std::move(ring->fItems[pos]));
+                pos = (pos + 1) % size;
+                --ring->fCount;
+            }
+        }
+    }
+
+    stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        const LogMetaData& ma = a.fRecord.metadata;
+        const LogMetaData& mb = b.fRecord.metadata;
+        return ma.timestamp < mb.timestamp || (ma.timestamp == mb.timestamp && ma.us < mb.us);
+    });
+
+    // the items do not move anymore, point the views to their own copies
+    for (Item& item : items) {
+        CustomSinkRecord& record = item.fRecord;
+        if (!record.origin.empty()) {
+            string_view origin(record.origin);
+            const size_t fileLen = record.metadata.file.size();
+            const size_t lineLen = record.metadata.line.size();
+            record.metadata.file = origin.substr(0, fileLen);
+            record.metadata.line = origin.substr(fileLen, lineLen);
+            record.metadata.func = origin.substr(fileLen + lineLen);
+        }
+    }
+    return items;
+}
+
+} // namespace fair
@@ -0,0 +1,79 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_FLIGHTRECORDER_H
+#define FAIR_LOGGER_FLIGHTRECORDER_H
+
+#include "Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace fair
+{
+
+// Keeps the most recent lines that no sink writes in one ring per thread, so that they can be written out when a line
+// of the trigger severity arrives. Recording copies the line into the ring of the calling thread, without I/O and
+// without touching data of other threads (the ring's mutex is only contended while the rings are taken).
+class Logger::FlightRecorder
+{
+  public:
+    struct Item
+    {
+        CustomSinkRecord fRecord;
+        const CallSite* fSite;
+        Verbosity fVerbosity;
+    };
+
+    FlightRecorder();
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+    ~FlightRecorder();
+
+    // capacity: lines per thread, a record severity of nolog or a capacity of 0 disables the recorder
+    void Configure(Severity recordSeverity, Severity triggerSeverity, size_t capacity);
+    // nolog if disabled
+    Severity RecordSeverity() const { return fRecordSeverity.load(std::memory_order_relaxed); }
+    bool Records(Severity severity) const
+    {
+        const Severity record = fRecordSeverity.load(std::memory_order_relaxed);
+        return record != Severity::nolog && severity >= record && severity < fTriggerSeverity.load(std::memory_order_relaxed);
+    }
+    bool Triggers(Severity severity) const
+    {
+        return fRecordSeverity.load(std::memory_order_relaxed) != Severity::nolog && severity >= fTriggerSeverity.load(std::memory_order_relaxed);
+    }
+
+    // copies the line into the ring of the calling thread, file, line and function as well if there is no call site
+    void Record(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, std::string_view content);
+    // removes the lines recorded up to the given time from all rings and returns them oldest first
+    std::vector<Item> Take(std::time_t timestamp, std::chrono::microseconds us);
+
+  private:
+    struct Ring;
+    // owned by the thread_local registration of each thread, listed in fRings while the thread runs
+    struct Registration;
+
+    Ring& LocalRing();
+    void Unregister(Ring* ring);
+
+    std::atomic<Severity> fRecordSeverity;
+    std::atomic<Severity> fTriggerSeverity;
+    std::atomic<size_t> fCapacity;
+    std::mutex fMtx;
+    std::vector<Ring*> fRings;
+    std::deque<Item> fFinished; // lines of finished threads, up to the capacity of one ring
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_FLIGHTRECORDER_H
@@ -6,18 +6,42 @@
  *                  copied verbatim in the file "LICENSE"                       *
  ********************************************************************************/
 #include "Logger.h"
+#include "BinaryFileSink.h"
+#include "CustomSinks.h"
+#include "FdWriter.h"
+#include "FlightRecorder.h"
+#include "RepeatFilter.h"
+#include "RingFileSink.h"
+#include "SinkWorker.h"
+#include "StatsCollector.h"
+#include "Throttle.h"
 #include <string_view>
 
-#if FMT_VERSION < 60000
-#include <fmt/time.h>
-#else
-#include <fmt/chrono.h>
-#endif
-
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <charconv> // from_chars
+#include <cstdint> // intptr_t
 #include <cstdio> // printf
-#include <ctime> // std::localtime
+#include <ctime> // localtime_r
 #include <iostream>
 #include <iterator> // std::back_inserter
+#include <limits>
+#include <memory> // std::unique_ptr
+#include <optional>
+#include <thread>
+#include <utility> // std::exchange
+
+#include <fnmatch.h>
+
+#include <time.h> // clock_gettime
+#include <unistd.h> // STDOUT_FILENO
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h> // __get_cpuid
+#include <x86intrin.h> // __rdtsc
+#define FAIR_LOGGER_HAVE_TSC
+#endif
 
 using namespace std;
 
@@ -26,15 +50,773 @@ namespace fair
 
 using VSpec = VerbositySpec;
 
-bool Logger::fColored = false;
-fstream Logger::fFileStream;
-Verbosity Logger::fVerbosity = Verbosity::low;
-Severity Logger::fConsoleSeverity = Severity::FAIR_MIN_SEVERITY > Severity::info ? Severity::FAIR_MIN_SEVERITY : Severity::info;
-Severity Logger::fMinSeverity = Severity::FAIR_MIN_SEVERITY > Severity::info ? Severity::FAIR_MIN_SEVERITY : Severity::info;
-Severity Logger::fFileSeverity = Severity::nolog;
+namespace
+{
+
+// Bounded lock-free queue for multiple producers and a single consumer (after D. Vyukov).
+// Each cell carries a sequence number that tells producers and the consumer whose turn it is.
+template<typename T>
+class MPSCQueue
+{
+  public:
+    explicit MPSCQueue(size_t capacity)
+        : fMask(0)
+        , fEnqueuePos(0)
+        , fDequeuePos(0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        fMask = size - 1;
+        fCells = make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            fCells[i].fSequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    // moves from value only on success, returns false if the queue is full
+    bool TryPush(T& value)
+    {
+        Cell* cell = nullptr;
+        size_t pos = fEnqueuePos.load(memory_order_relaxed);
+        while (true) {
+            cell = &fCells[pos & fMask];
+            size_t seq = cell->fSequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = fEnqueuePos.load(memory_order_relaxed);
+            }
+        }
+        cell->fData = std::move(value);
+        cell->fSequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool TryPop(T& value)
+    {
+        Cell& cell = fCells[fDequeuePos & fMask];
+        if (cell.fSequence.load(memory_order_acquire) != fDequeuePos + 1) {
+            return false;
+        }
+        value = std::move(cell.fData);
+        cell.fSequence.store(fDequeuePos + fMask + 1, memory_order_release);
+        ++fDequeuePos;
+        return true;
+    }
+
+    // consumer only
+    bool Empty() const { return fCells[fDequeuePos & fMask].fSequence.load() != fDequeuePos + 1; }
+
+    // number of slots claimed by producers so far
+    size_t Claimed() const { return fEnqueuePos.load(); }
+
+  private:
+    struct alignas(64) Cell
+    {
+        atomic<size_t> fSequence;
+        T fData;
+    };
+
+    unique_ptr<Cell[]> fCells;
+    size_t fMask;
+    alignas(64) atomic<size_t> fEnqueuePos;
+    alignas(64) size_t fDequeuePos;
+};
+
+// Bounded single-producer single-consumer ring. Producer and consumer positions live on separate cache lines and each
+// side caches the other one's position, so the shared lines are only read when the cached value says full/empty.
+template<typename T>
+class SPSCQueue
+{
+  public:
+    explicit SPSCQueue(size_t capacity)
+        : fMask(0)
+        , fHead(0)
+        , fTailCache(0)
+        , fTail(0)
+        , fHeadCache(0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        fMask = size - 1;
+        fCells = make_unique<T[]>(size);
+    }
+
+    // producer only, moves from value only on success, returns false if the queue is full
+    bool TryPush(T& value)
+    {
+        const size_t head = fHead.load(memory_order_relaxed);
+        if (head - fTailCache > fMask) {
+            fTailCache = fTail.load(memory_order_acquire);
+            if (head - fTailCache > fMask) {
+                return false;
+            }
+        }
+        fCells[head & fMask] = std::move(value);
+        fHead.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer only, oldest element or nullptr if empty
+    T* Front()
+    {
+        const size_t tail = fTail.load(memory_order_relaxed);
+        if (tail == fHeadCache) {
+            fHeadCache = fHead.load(memory_order_acquire);
+            if (tail == fHeadCache) {
+                return nullptr;
+            }
+        }
+        return &fCells[tail & fMask];
+    }
+
+    // consumer only, after Front() returned an element
+    void Pop() { fTail.store(fTail.load(memory_order_relaxed) + 1, memory_order_release); }
+
+    size_t Capacity() const { return fMask + 1; }
+
+  private:
+    unique_ptr<T[]> fCells;
+    size_t fMask;
+    alignas(64) atomic<size_t> fHead;
+    size_t fTailCache;
+    alignas(64) atomic<size_t> fTail;
+    size_t fHeadCache;
+};
+
+// Hazard pointers: before a thread uses an object that another thread may retire (the asynchronous writer, the queue
+// of the file sink), it announces the object in its own slot and checks that the object is still current. The retiring
+// thread waits until no slot announces the object any more. Each slot is written only by its own thread, so logging threads share no
+// cache line, and nothing is written at all while there is no such object.
+class Hazards
+{
+  public:
+    enum Kind : size_t
+    {
+        asyncWriter = 0,
+        fileWorker,
+        numKinds
+    };
+
+    // announces the current object of source in the slot of the calling thread until destruction
+    template<typename T>
+    class Guard
+    {
+      public:
+        Guard(Kind kind, const atomic<T*>& source)
+            : fSlot(nullptr)
+            , fPtr(source.load())
+        {
+            if (!fPtr) {
+                return;
+            }
+            fSlot = &Local().fPtrs[kind];
+            while (fPtr) {
+                fSlot->store(fPtr);
+                T* current = source.load();
+                if (current == fPtr) {
+                    break;
+                }
+                fPtr = current;
+            }
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard()
+        {
+            if (fSlot) {
+                fSlot->store(nullptr, memory_order_release);
+            }
+        }
+
+        T* Get() const { return fPtr; }
+
+      private:
+        atomic<const void*>* fSlot;
+        T* fPtr;
+    };
+
+    // waits until no thread announces ptr, which must not be reachable from its source any more
+    static void WaitUnused(Kind kind, const void* ptr)
+    {
+        Registry& registry = Get();
+        while (true) {
+            {
+                lock_guard<mutex> lock(registry.fMtx);
+                if (none_of(registry.fSlots.cbegin(), registry.fSlots.cend(), [&](const Slot* slot) { return slot->fPtrs[kind].load() == ptr; })) {
+                    return;
+                }
+            }
+            this_thread::yield();
+        }
+    }
+
+  private:
+    struct alignas(64) Slot
+    {
+        array<atomic<const void*>, numKinds> fPtrs{};
+    };
+
+    struct Registry
+    {
+        mutex fMtx;
+        vector<Slot*> fSlots;
+    };
+
+    // never destroyed, threads may finish after the static destructors have run
+    static Registry& Get()
+    {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    static Slot& Local()
+    {
+        struct Registration
+        {
+            Registration()
+            {
+                lock_guard<mutex> lock(Get().fMtx);
+                Get().fSlots.push_back(&fSlot);
+            }
+            ~Registration()
+            {
+                lock_guard<mutex> lock(Get().fMtx);
+                Get().fSlots.erase(find(Get().fSlots.begin(), Get().fSlots.end(), &fSlot));
+            }
+            Slot fSlot;
+        };
+        thread_local Registration registration;
+        return registration.fSlot;
+    }
+};
+
+// formats deferred arguments (LOGPA, LOGFA) and prepends the result to the streamed content
+string FormatDeferred(Logger::DeferredFormatter formatter, string_view format, const char* args, string_view content)
+{
+    fmt::memory_buffer out;
+    try {
+        formatter(format, args, out);
+    } catch (const fmt::format_error& e) {
+        out.clear();
+        fmt::format_to(back_inserter(out), "[format error in \"{}\": {}]", format, e.what());
+    }
+    out.append(content.data(), content.data() + content.size());
+    return to_string(out);
+}
+
+// maps time stamp counter ticks to microseconds since the epoch, immutable once published
+struct TscCalibration
+{
+    uint64_t fTicks = 0;
+    int64_t fMicroseconds = 0;
+    double fMicrosecondsPerTick = 0.;
+};
+
+// published once when the tsc clock is first selected (never freed), null until then
+atomic<const TscCalibration*> gTscCalibration(nullptr);
+
+int64_t SystemClockMicroseconds()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#ifdef FAIR_LOGGER_HAVE_TSC
+bool CalibrateTsc()
+{
+    // the counter must tick at a constant rate, otherwise frequency changes would distort the time
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8))) {
+        return false;
+    }
+
+    const uint64_t ticks0 = __rdtsc();
+    const int64_t us0 = SystemClockMicroseconds();
+    this_thread::sleep_for(chrono::milliseconds(20));
+    const uint64_t ticks1 = __rdtsc();
+    const int64_t us1 = SystemClockMicroseconds();
+    if (ticks1 <= ticks0 || us1 <= us0) {
+        return false;
+    }
+
+    auto calibration = new TscCalibration();
+    calibration->fTicks = ticks1;
+    calibration->fMicroseconds = us1;
+    calibration->fMicrosecondsPerTick = static_cast<double>(us1 - us0) / static_cast<double>(ticks1 - ticks0);
+    gTscCalibration.store(calibration, memory_order_release);
+    return true;
+}
+#endif
+
+// microseconds since the epoch from the given clock
+int64_t ClockMicroseconds(Logger::ClockSource source)
+{
+    switch (source) {
+#ifdef CLOCK_REALTIME_COARSE
+        case Logger::ClockSource::coarse: {
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        }
+#endif
+#ifdef FAIR_LOGGER_HAVE_TSC
+        case Logger::ClockSource::tsc:
+            if (const TscCalibration* calibration = gTscCalibration.load(memory_order_acquire)) {
+                return calibration->fMicroseconds + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(__rdtsc() - calibration->fTicks)) * calibration->fMicrosecondsPerTick);
+            }
+            return SystemClockMicroseconds();
+#endif
+        default:
+            return SystemClockMicroseconds();
+    }
+}
+
+// rules and registered sites of the call site registry, never destroyed (sites may log during static destruction)
+struct CallSiteRegistry
+{
+    struct Rule
+    {
+        string fFileGlob;
+        string fFunctionGlob;
+        int fFirstLine;
+        int fLastLine;
+        CallSite::State fState;
+
+        bool Matches(const CallSite& site) const
+        {
+            return site.fLine >= fFirstLine && site.fLine <= fLastLine
+                && fnmatch(fFileGlob.c_str(), string(site.fFile).c_str(), 0) == 0
+                && fnmatch(fFunctionGlob.c_str(), string(site.fFunc).c_str(), 0) == 0;
+        }
+    };
+
+    mutex fMtx;
+    vector<const CallSite*> fSites;
+    vector<Rule> fRules;
+};
+
+CallSiteRegistry& Registry()
+{
+    static CallSiteRegistry* registry = new CallSiteRegistry;
+    return *registry;
+}
+
+// finished log line as handed over to the asynchronous writer
+struct LogRecord
+{
+    ExtendedLogMetaData fInfos;
+    // static call site of the LOG macros, its strings live as long as the program
+    const CallSite* fSite = nullptr;
+    // otherwise (LOGD) an owned copy of file, line and function, the string views in fInfos are rebound to it by Rebind()
+    string fOrigin;
+    Verbosity fVerbosity = Verbosity::low;
+    string fContent;
+    // deferred formatting, done on the writer thread
+    Logger::DeferredFormatter fFormatter = nullptr;
+    string_view fFormat;
+    const char* fTypes = nullptr;
+    string fArgs;
+    // steady clock (ns) when the record was queued, merge key of the per-thread queues
+    int64_t fStamp = 0;
+
+    void Rebind()
+    {
+        if (fSite) {
+            return;
+        }
+        string_view origin(fOrigin);
+        size_t fileLen = fInfos.file.size();
+        size_t lineLen = fInfos.line.size();
+        fInfos.file = origin.substr(0, fileLen);
+        fInfos.line = origin.substr(fileLen, lineLen);
+        fInfos.func = origin.substr(fileLen + lineLen);
+    }
+};
+
+} // namespace
+
+class Logger::AsyncWriter
+{
+  public:
+    AsyncWriter(size_t capacity, AsyncQueues queues)
+        : fPerThread(queues == AsyncQueues::per_thread)
+        , fCapacity(capacity)
+        , fGeneration(fGenerations.fetch_add(1) + 1)
+        , fQueue(fPerThread ? 2 : capacity)
+        , fHasNew(false)
+        , fRetired(0)
+        , fWritten(0)
+        , fFlushWaiters(0)
+        , fSleeping(false)
+        , fStop(false)
+    {
+        fThread = thread(&AsyncWriter::Run, this);
+    }
+
+    void Push(LogRecord& record)
+    {
+        if (fPerThread) {
+            Staging& staging = LocalStaging();
+            record.fStamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+            while (!staging.TryPush(record)) {
+                Wake();
+                this_thread::yield();
+            }
+        } else {
+            while (!fQueue.TryPush(record)) {
+                Wake();
+                this_thread::yield();
+            }
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if (fSleeping.load(memory_order_relaxed)) {
+            Wake();
+        }
+    }
+
+    void Flush()
+    {
+        size_t target = fQueue.Claimed();
+        if (fPerThread) {
+            lock_guard<mutex> lock(fStagingsMtx);
+            target = fRetired;
+            for (const auto& staging : fAllStagings) {
+                target += staging->Pushed();
+            }
+        }
+        fFlushWaiters.fetch_add(1);
+        {
+            unique_lock<mutex> lock(fMtx);
+            fWakeUp.notify_one();
+            fDrained.wait(lock, [&]() { return fWritten.load() >= target; });
+        }
+        fFlushWaiters.fetch_sub(1);
+    }
+
+    // to be called only after all producers are gone, writes everything still queued
+    void Stop()
+    {
+        {
+            lock_guard<mutex> lock(fMtx);
+            fStop = true;
+        }
+        fWakeUp.notify_one();
+        fThread.join();
+    }
+
+    static thread_local bool fOnWriterThread;
+
+  private:
+    // Queue of one producer thread, shared by the thread and the writer, closed when the thread exits. It starts with a
+    // small ring: when the ring is full, the producer links a ring of twice the size (up to the capacity) and continues
+    // there, the writer moves on to it once the previous ring is drained and frees that one.
+    struct Staging
+    {
+        struct Ring
+        {
+            explicit Ring(size_t capacity) : fQueue(capacity), fNext(nullptr) {}
+            SPSCQueue<LogRecord> fQueue;
+            atomic<Ring*> fNext;
+        };
+
+        explicit Staging(size_t capacity)
+            : fCapacity(capacity)
+            , fHead(new Ring(min(capacity, fInitialRing)))
+            , fTail(fHead)
+            , fPushed(0)
+            , fClosed(false)
+        {}
+        Staging(const Staging&) = delete;
+        Staging& operator=(const Staging&) = delete;
+        ~Staging()
+        {
+            while (fHead) {
+                delete exchange(fHead, fHead->fNext.load());
+            }
+        }
+
+        // producer only, moves from record only on success, returns false if the queue is full
+        bool TryPush(LogRecord& record)
+        {
+            if (!fTail->fQueue.TryPush(record)) {
+                if (fTail->fQueue.Capacity() >= fCapacity) {
+                    return false;
+                }
+                Ring* next = new Ring(min(2 * fTail->fQueue.Capacity(), fCapacity));
+                next->fQueue.TryPush(record);
+                fTail->fNext.store(next, memory_order_release);
+                fTail = next;
+            }
+            fPushed.store(fPushed.load(memory_order_relaxed) + 1, memory_order_release);
+            return true;
+        }
+
+        // consumer only, oldest record or nullptr if empty
+        LogRecord* Front()
+        {
+            LogRecord* record = fHead->fQueue.Front();
+            while (!record) {
+                Ring* next = fHead->fNext.load(memory_order_acquire);
+                if (!next) {
+                    return nullptr;
+                }
+                // the producer had finished with the ring before it linked the next one
+                record = fHead->fQueue.Front();
+                if (!record) {
+                    delete exchange(fHead, next);
+                    record = fHead->fQueue.Front();
+                }
+            }
+            return record;
+        }
+
+        // consumer only, after Front() returned a record
+        void Pop() { fHead->fQueue.Pop(); }
+
+        // number of records pushed so far
+        size_t Pushed() const { return fPushed.load(memory_order_acquire); }
+
+        static constexpr size_t fInitialRing = 64;
+
+        const size_t fCapacity;
+        Ring* fHead; // consumer only
+        Ring* fTail; // producer only
+        alignas(64) atomic<size_t> fPushed;
+        alignas(64) atomic<bool> fClosed;
+    };
+
+    // records logged by a thread within this window may still be on their way into its queue
+    static constexpr int64_t fReorderWindow = 1000000; // ns
+
+    Staging& LocalStaging()
+    {
+        struct Holder
+        {
+            uint64_t fGeneration = 0;
+            shared_ptr<Staging> fStaging;
+            ~Holder()
+            {
+                if (fStaging) {
+                    fStaging->fClosed.store(true, memory_order_release);
+                }
+            }
+        };
+        thread_local Holder holder;
+        if (holder.fGeneration != fGeneration) {
+            // first record of this thread for this writer
+            if (holder.fStaging) {
+                holder.fStaging->fClosed.store(true, memory_order_release);
+            }
+            holder.fStaging = make_shared<Staging>(fCapacity);
+            holder.fGeneration = fGeneration;
+            {
+                lock_guard<mutex> lock(fStagingsMtx);
+                fAllStagings.push_back(holder.fStaging);
+                fNewStagings.push_back(holder.fStaging);
+            }
+            fHasNew.store(true, memory_order_release);
+        }
+        return *holder.fStaging;
+    }
+
+    void Wake()
+    {
+        { lock_guard<mutex> lock(fMtx); }
+        fWakeUp.notify_one();
+    }
+
+    void WriteRecord(LogRecord& record)
+    {
+        record.Rebind();
+        try {
+            Logger::Write(record.fInfos, record.fSite, record.fVerbosity, record.fContent, { record.fFormatter, record.fFormat, record.fTypes, record.fArgs });
+        } catch (const exception& e) {
+            fprintf(stderr, "Logger: exception while writing asynchronous record: %s\n", e.what());
+        }
+        fWritten.fetch_add(1);
+        if (fFlushWaiters.load() > 0) {
+            lock_guard<mutex> lock(fMtx);
+            fDrained.notify_all();
+        }
+    }
+
+    // consumer only, picks up queues of new threads and drops drained queues of finished ones
+    void UpdateStagings()
+    {
+        const bool hasNew = fHasNew.exchange(false, memory_order_acquire);
+        auto finished = [](const shared_ptr<Staging>& staging) {
+            return staging->fClosed.load(memory_order_acquire) && !staging->Front();
+        };
+        const bool anyFinished = any_of(fStagings.cbegin(), fStagings.cend(), finished);
+        if (!hasNew && !anyFinished) {
+            return;
+        }
+        lock_guard<mutex> lock(fStagingsMtx);
+        for (auto& staging : fNewStagings) {
+            fStagings.push_back(std::move(staging));
+        }
+        fNewStagings.clear();
+        for (auto it = fStagings.begin(); it != fStagings.end();) {
+            if (finished(*it)) {
+                fRetired += (*it)->Pushed();
+                fAllStagings.erase(find(fAllStagings.begin(), fAllStagings.end(), *it));
+                it = fStagings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Writes the oldest record of all per-thread queues (k-way merge on fStamp). A record younger than the reorder window
+    // waits while another queue is empty, as that thread may be about to push an older one. Returns false if nothing was
+    // written, with the time to wait for the held back record in holdUntil (0 if all queues are empty).
+    bool WriteStaged(int64_t& holdUntil)
+    {
+        UpdateStagings();
+        holdUntil = 0;
+        Staging* oldest = nullptr;
+        LogRecord* oldestRecord = nullptr;
+        bool complete = true;
+        for (const auto& staging : fStagings) {
+            LogRecord* record = staging->Front();
+            if (!record) {
+                complete = complete && staging->fClosed.load(memory_order_relaxed);
+                continue;
+            }
+            if (!oldestRecord || record->fStamp < oldestRecord->fStamp) {
+                oldest = staging.get();
+                oldestRecord = record;
+            }
+        }
+        if (!oldestRecord) {
+            return false;
+        }
+        if (!complete && !fStop && fFlushWaiters.load() == 0) {
+            const int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+            if (oldestRecord->fStamp + fReorderWindow > now) {
+                holdUntil = oldestRecord->fStamp + fReorderWindow;
+                return false;
+            }
+        }
+        WriteRecord(*oldestRecord);
+        *oldestRecord = LogRecord(); // release the strings of the record now, not when the slot is reused
+        oldest->Pop();
+        return true;
+    }
+
+    // consumer only
+    bool Empty()
+    {
+        if (!fPerThread) {
+            return fQueue.Empty();
+        }
+        UpdateStagings();
+        return none_of(fStagings.cbegin(), fStagings.cend(), [](const shared_ptr<Staging>& staging) { return staging->Front(); });
+    }
+
+    void Run()
+    {
+        fOnWriterThread = true;
+        LogRecord record;
+        int idle = 0;
+
+        while (true) {
+            int64_t holdUntil = 0;
+            if (fPerThread ? WriteStaged(holdUntil) : fQueue.TryPop(record)) {
+                if (!fPerThread) {
+                    WriteRecord(record);
+                }
+                idle = 0;
+                continue;
+            }
+            if (holdUntil > 0) {
+                this_thread::sleep_until(chrono::steady_clock::time_point(chrono::duration_cast<chrono::steady_clock::duration>(chrono::nanoseconds(holdUntil))));
+                continue;
+            }
+
+            if (++idle < 64) {
+                this_thread::yield();
+                continue;
+            }
+
+            unique_lock<mutex> lock(fMtx);
+            if (fStop && Empty()) {
+                break;
+            }
+            fSleeping.store(true, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            fWakeUp.wait_for(lock, chrono::milliseconds(100), [&]() { return fStop || !Empty(); });
+            fSleeping.store(false, memory_order_relaxed);
+        }
+    }
+
+    static atomic<uint64_t> fGenerations;
+
+    const bool fPerThread;
+    const size_t fCapacity;
+    const uint64_t fGeneration; // tells the threads' cached queues of an earlier writer from the own ones
+
+    MPSCQueue<LogRecord> fQueue; // shared queue (AsyncQueues::shared)
+
+    // per-thread queues (AsyncQueues::per_thread)
+    vector<shared_ptr<Staging>> fStagings; // consumer only
+    mutex fStagingsMtx;
+    vector<shared_ptr<Staging>> fNewStagings; // not yet seen by the consumer
+    vector<shared_ptr<Staging>> fAllStagings; // for Flush()
+    atomic<bool> fHasNew;
+    size_t fRetired; // records pushed to queues that were dropped, under fStagingsMtx
+
+    atomic<size_t> fWritten;
+    atomic<int> fFlushWaiters;
+    atomic<bool> fSleeping;
+    atomic<bool> fStop;
+    mutex fMtx;
+    condition_variable fWakeUp;
+    condition_variable fDrained;
+    thread fThread;
+};
+
+atomic<uint64_t> Logger::AsyncWriter::fGenerations(0);
+thread_local bool Logger::AsyncWriter::fOnWriterThread = false;
+
+atomic<bool> Logger::fColored(false);
+atomic<Logger::ConsoleOutput> Logger::fConsoleOutput(Logger::ConsoleOutput::stdio);
+Logger::FdWriter Logger::fConsoleWriter(STDOUT_FILENO);
+Logger::FdWriter Logger::fFileWriter;
+atomic<Verbosity> Logger::fVerbosity(Verbosity::low);
+atomic<uint64_t> Logger::fSequence(0);
+atomic<Logger::ClockSource> Logger::fClockSource(Logger::ClockSource::precise);
+atomic<Severity> Logger::fConsoleSeverity(Severity::FAIR_MIN_SEVERITY > Severity::info ? Severity::FAIR_MIN_SEVERITY : Severity::info);
+atomic<Severity> Logger::fMinSeverity(Severity::FAIR_MIN_SEVERITY > Severity::info ? Severity::FAIR_MIN_SEVERITY : Severity::info);
+atomic<Severity> Logger::fFileSeverity(Severity::nolog);
+atomic<Severity> Logger::fBinaryFileSeverity(Severity::nolog);
+atomic<Severity> Logger::fRingFileSeverity(Severity::nolog);
+atomic<Severity> Logger::fCustomSinksSeverity(Severity::nolog);
+mutex Logger::fSeverityMtx;
 function<void()> Logger::fFatalCallback;
-unordered_map<string, pair<Severity, function<void(const string& content, const LogMetaData& metadata)>>> Logger::fCustomSinks;
+Logger::StatsCollector Logger::fStats; // outlives the custom sinks, which hold slots of it
+Logger::CustomSinks Logger::fCustomSinks;
 mutex Logger::fMtx;
+Logger::BinaryFileSink Logger::fBinaryFileSink;
+Logger::RingFileSink Logger::fRingFileSink;
+Logger::FlightRecorder Logger::fFlightRecorder;
+Logger::RepeatFilter Logger::fConsoleRepeats;
+Logger::RepeatFilter Logger::fFileRepeats;
+atomic<Logger::RepeatTimer*> Logger::fRepeatTimer(nullptr);
+Logger::Throttle Logger::fThrottle;
+atomic<Logger::AsyncWriter*> Logger::fAsyncWriter(nullptr);
+atomic<Logger::SinkWorker*> Logger::fFileWorker(nullptr);
+atomic<uint64_t> Logger::fFileDrops(0);
 bool Logger::fIsDestructed = false;
 Logger::DestructionHelper fDestructionHelper;
 
@@ -135,152 +917,815 @@ const array<string_view, 9> Logger::fVerbosityNames =
     }
 };
 
-map<Verbosity, VSpec> Logger::fVerbosities =
-{
-    { Verbosity::verylow,  VSpec::Make()                                                                                                             },
-    { Verbosity::low,      VSpec::Make(VSpec::Info::severity)                                                                                        },
-    { Verbosity::medium,   VSpec::Make(VSpec::Info::timestamp_s, VSpec::Info::severity)                                                              },
-    { Verbosity::high,     VSpec::Make(VSpec::Info::process_name, VSpec::Info::timestamp_s, VSpec::Info::severity)                                   },
-    { Verbosity::veryhigh, VSpec::Make(VSpec::Info::process_name, VSpec::Info::timestamp_us, VSpec::Info::severity, VSpec::Info::file_line_function) },
-    { Verbosity::user1,    VSpec::Make(VSpec::Info::severity)                                                                                        },
-    { Verbosity::user2,    VSpec::Make(VSpec::Info::severity)                                                                                        },
-    { Verbosity::user3,    VSpec::Make(VSpec::Info::severity)                                                                                        },
-    { Verbosity::user4,    VSpec::Make(VSpec::Info::severity)                                                                                        }
+array<VSpec, 9> Logger::fVerbosities =
+{
+    {
+        VSpec::Make(),                                                                                                             // verylow
+        VSpec::Make(VSpec::Info::severity),                                                                                        // low
+        VSpec::Make(VSpec::Info::timestamp_s, VSpec::Info::severity),                                                              // medium
+        VSpec::Make(VSpec::Info::process_name, VSpec::Info::timestamp_s, VSpec::Info::severity),                                   // high
+        VSpec::Make(VSpec::Info::process_name, VSpec::Info::timestamp_us, VSpec::Info::severity, VSpec::Info::file_line_function), // veryhigh
+        VSpec::Make(VSpec::Info::severity),                                                                                        // user1
+        VSpec::Make(VSpec::Info::severity),                                                                                        // user2
+        VSpec::Make(VSpec::Info::severity),                                                                                        // user3
+        VSpec::Make(VSpec::Info::severity)                                                                                         // user4
+    }
+};
+
+namespace
+{
+
+bool HasTimestamp(const VSpec& spec)
+{
+    return any_of(spec.fInfos.cbegin(), spec.fInfos.cbegin() + spec.fSize, [](VSpec::Info info) { return info == VSpec::Info::timestamp_s || info == VSpec::Info::timestamp_us; });
+}
+
+const char DigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+inline void PutDigitPair(char* dst, unsigned value)
+{
+    memcpy(dst, DigitPairs + 2 * value, 2);
+}
+
+// HH:MM:SS of the last second seen by this thread, localtime_r is called only when the second changes
+struct TimeCache
+{
+    time_t fSecond = numeric_limits<time_t>::min();
+    char fText[8];
 };
 
+thread_local TimeCache tTimeCache;
+
+void AppendTime(fmt::memory_buffer& out, time_t timestamp)
+{
+    TimeCache& cache = tTimeCache;
+    if (cache.fSecond != timestamp) {
+        tm local{};
+        localtime_r(&timestamp, &local);
+        PutDigitPair(cache.fText, local.tm_hour);
+        cache.fText[2] = ':';
+        PutDigitPair(cache.fText + 3, local.tm_min);
+        cache.fText[5] = ':';
+        PutDigitPair(cache.fText + 6, local.tm_sec % 100); // leap second: 60
+        cache.fSecond = timestamp;
+    }
+    out.append(cache.fText, cache.fText + sizeof(cache.fText));
+}
+
+// .uuuuuu
+void AppendMicroseconds(fmt::memory_buffer& out, chrono::microseconds us)
+{
+    const auto count = us.count();
+    if (count < 0 || count > 999999) {
+        fmt::format_to(back_inserter(out), ".{:06}", count);
+        return;
+    }
+    const unsigned value = static_cast<unsigned>(count);
+    char text[7];
+    text[0] = '.';
+    PutDigitPair(text + 1, value / 10000);
+    PutDigitPair(text + 3, value / 100 % 100);
+    PutDigitPair(text + 5, value % 100);
+    out.append(text, text + sizeof(text));
+}
+
+} // namespace
+
 Logger::Logger(Severity severity, Verbosity verbosity, std::string_view file, std::string_view line, std::string_view func)
-    : fTimeCalculated(false)
+    : fInfos()
+    , fSite(nullptr)
+    , fDeferredFormatter(nullptr)
+    , fDeferredTypes(nullptr)
+    , fLineVerbosity(verbosity)
+    , fSuppressed(0)
+    , fTimeCalculated(false)
 {
     if (!fIsDestructed) {
-        size_t pos = file.rfind("/");
-        // fInfos.timestamp is filled conditionally
-        // fInfos.us is filled conditionally
-        fInfos.process_name = fProcessName;
-        fInfos.file = file.substr(pos + 1);
+        fInfos.file = CallSite::Basename(file);
         fInfos.line = line;
         fInfos.func = func;
-        fInfos.severity_name = fSeverityNames.at(static_cast<size_t>(severity));
-        fInfos.severity = severity;
-
-        auto spec = fVerbosities[verbosity];
-
-        if ((!fColored && LoggingToConsole()) || LoggingToFile()) {
-            for (const auto info : spec.fInfos) {
-                switch (info) {
-                    case VSpec::Info::process_name:
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{}]", fInfos.process_name);
-                        break;
-                    case VSpec::Info::timestamp_us:
-                        FillTimeInfos();
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{:%H:%M:%S}.{:06}]", *std::localtime(&fInfos.timestamp), fInfos.us.count());
-                        break;
-                    case VSpec::Info::timestamp_s:
-                        FillTimeInfos();
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{:%H:%M:%S}]", *std::localtime(&fInfos.timestamp));
-                        break;
-                    case VSpec::Info::severity:
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{}]", fInfos.severity_name);
-                        break;
-                    case VSpec::Info::file_line_function:
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{}:{}:{}]", fInfos.file, fInfos.line, fInfos.func);
-                        break;
-                    case VSpec::Info::file_line:
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{}:{}]", fInfos.file, fInfos.line);
-                        break;
-                    case VSpec::Info::file:
-                        fmt::format_to(std::back_inserter(fBWPrefix), "[{}]", fInfos.file);
-                        break;
-                    default:
-                        break;
-                }
+        Init(severity);
+    }
+}
+
+Logger::Logger(Severity severity, Verbosity verbosity, const CallSite& site)
+    : fInfos()
+    , fSite(&site)
+    , fDeferredFormatter(nullptr)
+    , fDeferredTypes(nullptr)
+    , fLineVerbosity(verbosity)
+    , fSuppressed(0)
+    , fTimeCalculated(false)
+{
+    if (!fIsDestructed) {
+        fInfos.file = site.fFile;
+        fInfos.line = site.fLineStr;
+        fInfos.func = site.fFunc;
+        Init(severity);
+    }
+}
+
+void Logger::Init(Severity severity)
+{
+    // fInfos.timestamp is filled conditionally
+    // fInfos.us is filled conditionally
+    fInfos.process_name = fProcessName;
+    fInfos.severity_name = fSeverityNames.at(static_cast<size_t>(severity));
+    fInfos.severity = severity;
+
+    // the prefix itself is rendered in Write(), only the time has to be taken now
+    const bool forced = fSite && fSite->GetState() == CallSite::State::enabled;
+    const bool custom = LoggingCustom(severity, fCustomSinksSeverity.load(memory_order_relaxed));
+    if (((forced || LoggingToConsole(severity) || LoggingToFile(severity) || LoggingToRingFile(severity)) && HasTimestamp(fVerbosities.at(static_cast<size_t>(fLineVerbosity))))
+        || custom
+        || LoggingToBinaryFile(severity)
+        || fFlightRecorder.Records(severity)
+        || fFlightRecorder.Triggers(severity)) {
+        FillTimeInfos();
+    }
+    if (custom) {
+        FillExtendedInfos(severity);
+    }
+}
+
+void Logger::FillExtendedInfos(Severity /* severity */)
+{
+    fInfos.thread_id = this_thread::get_id();
+    fInfos.steady = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch());
+    if (fSite) {
+        fInfos.line_number = fSite->fLine;
+    } else {
+        fInfos.line_number = 0;
+        from_chars(fInfos.line.data(), fInfos.line.data() + fInfos.line.size(), fInfos.line_number);
+    }
+    fInfos.sequence = fSequence.fetch_add(1, memory_order_relaxed);
+}
+
+string_view CallSite::Location(VerbositySpec::Info info, bool colored) const
+{
+    const size_t index = 2 * (static_cast<size_t>(info) - static_cast<size_t>(VSpec::Info::file)) + (colored ? 1 : 0);
+    auto& slot = fLocations.at(index);
+    const string* location = slot.load(memory_order_acquire);
+    if (!location) {
+        fmt::memory_buffer out;
+        Logger::FormatLocation(out, info, fFile, fLineStr, fFunc, colored);
+        auto rendered = make_unique<string>(out.data(), out.size());
+        // lives as long as the (static) call site, another thread may have been faster
+        if (slot.compare_exchange_strong(location, rendered.get(), memory_order_acq_rel)) {
+            location = rendered.release();
+        }
+    }
+    return *location;
+}
+
+CallSite::State CallSite::Register() const
+{
+    CallSiteRegistry& registry = Registry();
+    lock_guard<mutex> lock(registry.fMtx);
+    if (GetState() == State::unregistered) {
+        State state = State::severity;
+        for (const auto& rule : registry.fRules) {
+            if (rule.Matches(*this)) {
+                state = rule.fState;
+            }
+        }
+        registry.fSites.push_back(this);
+        fState.store(static_cast<int>(state), memory_order_relaxed);
+    }
+    return GetState();
+}
+
+size_t Logger::SetCallSites(const string& fileGlob, const string& functionGlob, int firstLine, int lastLine, CallSite::State state)
+{
+    CallSiteRegistry& registry = Registry();
+    lock_guard<mutex> lock(registry.fMtx);
+    registry.fRules.push_back({ fileGlob, functionGlob, firstLine, lastLine, state });
+    size_t matched = 0;
+    for (const CallSite* site : registry.fSites) {
+        if (registry.fRules.back().Matches(*site)) {
+            site->fState.store(static_cast<int>(state), memory_order_relaxed);
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+size_t Logger::EnableCallSites(const string& fileGlob, const string& functionGlob, int firstLine, int lastLine)
+{
+    return SetCallSites(fileGlob, functionGlob, firstLine, lastLine, CallSite::State::enabled);
+}
+
+size_t Logger::DisableCallSites(const string& fileGlob, const string& functionGlob, int firstLine, int lastLine)
+{
+    return SetCallSites(fileGlob, functionGlob, firstLine, lastLine, CallSite::State::disabled);
+}
+
+void Logger::ResetCallSites()
+{
+    CallSiteRegistry& registry = Registry();
+    lock_guard<mutex> lock(registry.fMtx);
+    registry.fRules.clear();
+    for (const CallSite* site : registry.fSites) {
+        site->fState.store(static_cast<int>(CallSite::State::severity), memory_order_relaxed);
+    }
+}
+
+vector<Logger::CallSiteInfo> Logger::GetCallSites()
+{
+    CallSiteRegistry& registry = Registry();
+    lock_guard<mutex> lock(registry.fMtx);
+    vector<CallSiteInfo> sites;
+    sites.reserve(registry.fSites.size());
+    for (const CallSite* site : registry.fSites) {
+        sites.push_back({ site->fFile, site->fLine, site->fFunc, site->GetState() });
+    }
+    return sites;
+}
+
+void Logger::FormatLocation(fmt::memory_buffer& out, VerbositySpec::Info info, string_view file, string_view line, string_view func, bool colored)
+{
+    auto it = back_inserter(out);
+
+    if (!colored) {
+        switch (info) {
+            case VSpec::Info::file_line_function:
+                fmt::format_to(it, "[{}:{}:{}]", file, line, func);
+                break;
+            case VSpec::Info::file_line:
+                fmt::format_to(it, "[{}:{}]", file, line);
+                break;
+            case VSpec::Info::file:
+                fmt::format_to(it, "[{}]", file);
+                break;
+            default:
+                break;
+        }
+    } else {
+        switch (info) {
+            case VSpec::Info::file_line_function:
+                fmt::format_to(it, "[{}:{}:{}]", ColorOut(Color::fgBlue, file), ColorOut(Color::fgYellow, line), ColorOut(Color::fgBlue, func));
+                break;
+            case VSpec::Info::file_line:
+                fmt::format_to(it, "[{}:{}]", ColorOut(Color::fgBlue, file), ColorOut(Color::fgYellow, line));
+                break;
+            case VSpec::Info::file:
+                fmt::format_to(it, "[{}]", ColorOut(Color::fgBlue, file));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Logger::FormatPrefix(fmt::memory_buffer& out, const VerbositySpec& spec, const LogMetaData& infos, bool colored, const CallSite* site)
+{
+    auto it = back_inserter(out);
+    auto location = [&](VSpec::Info info) {
+        if (site) {
+            string_view cached = site->Location(info, colored);
+            out.append(cached.data(), cached.data() + cached.size());
+        } else {
+            FormatLocation(out, info, infos.file, infos.line, infos.func, colored);
+        }
+    };
+
+    if (!colored) {
+        for (const auto info : spec.fInfos) {
+            switch (info) {
+                case VSpec::Info::process_name:
+                    fmt::format_to(it, "[{}]", infos.process_name);
+                    break;
+                case VSpec::Info::timestamp_us:
+                    out.push_back('[');
+                    AppendTime(out, infos.timestamp);
+                    AppendMicroseconds(out, infos.us);
+                    out.push_back(']');
+                    break;
+                case VSpec::Info::timestamp_s:
+                    out.push_back('[');
+                    AppendTime(out, infos.timestamp);
+                    out.push_back(']');
+                    break;
+                case VSpec::Info::severity:
+                    fmt::format_to(it, "[{}]", infos.severity_name);
+                    break;
+                case VSpec::Info::file_line_function:
+                case VSpec::Info::file_line:
+                case VSpec::Info::file:
+                    location(info);
+                    break;
+                default:
+                    break;
             }
+        }
+    } else {
+        for (const auto info : spec.fInfos) {
+            switch (info) {
+                case VSpec::Info::process_name:
+                    fmt::format_to(it, "[{}]", ColorOut(Color::fgBlue, infos.process_name));
+                    break;
+                case VSpec::Info::timestamp_us:
+                    fmt::format_to(it, "[\033[01;{}m", static_cast<int>(Color::fgCyan));
+                    AppendTime(out, infos.timestamp);
+                    AppendMicroseconds(out, infos.us);
+                    fmt::format_to(it, "\033[0m]");
+                    break;
+                case VSpec::Info::timestamp_s:
+                    fmt::format_to(it, "[\033[01;{}m", static_cast<int>(Color::fgCyan));
+                    AppendTime(out, infos.timestamp);
+                    fmt::format_to(it, "\033[0m]");
+                    break;
+                case VSpec::Info::severity:
+                    fmt::format_to(it, "[{}]", GetColoredSeverityString(infos.severity));
+                    break;
+                case VSpec::Info::file_line_function:
+                case VSpec::Info::file_line:
+                case VSpec::Info::file:
+                    location(info);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    if (spec.fSize > 0) {
+        fmt::format_to(it, " ");
+    }
+}
+
+Logger::~Logger() noexcept(false)
+{
+    if (fIsDestructed) {
+        printf("post-static destruction output: %s\n", Content().c_str());
+        return;
+    }
+
+    if (fSuppressed > 0) {
+        fmt::format_to(back_inserter(fContent), " [{} suppressed]", fSuppressed);
+    }
+    const StatsCollector::Line stats(fStats, fInfos.severity, fContent.size() + fDeferredArgs.size());
+
+    if (fFlightRecorder.Records(fInfos.severity) && !Written(fInfos.severity, fSite)) {
+        // kept in memory only, custom sinks still get the line
+        if (fDeferredFormatter) {
+            fFlightRecorder.Record(fInfos, fSite, fLineVerbosity, Content());
+        } else {
+            fFlightRecorder.Record(fInfos, fSite, fLineVerbosity, string_view(fContent.data(), fContent.size()));
+        }
+        if (!LoggingCustom(fInfos.severity, fCustomSinksSeverity.load(memory_order_relaxed))) {
+            return;
+        }
+    }
+
+    if (fThrottle.Enabled() && !Throttle::fReporting) {
+        const int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        const bool admitted = fThrottle.Admit(fInfos.severity, fContent.size() + fDeferredArgs.size(), now);
+        ReportThrottle(now);
+        if (!admitted) {
+            return;
+        }
+    }
+
+    if (!Enqueue()) {
+        Write(fInfos,
+              fSite,
+              fLineVerbosity,
+              string_view(fContent.data(), fContent.size()),
+              { fDeferredFormatter, fDeferredFormat, fDeferredTypes, string_view(fDeferredArgs.data(), fDeferredArgs.size()) });
+    }
+
+    if (fInfos.severity == Severity::fatal) {
+        // make sure the fatal line (and everything before it) is written before the callback gets a chance to exit
+        Flush();
+        if (fFatalCallback) {
+            fFatalCallback();
+        }
+    }
+}
+
+string Logger::Content() const
+{
+    if (fDeferredFormatter) {
+        return FormatDeferred(fDeferredFormatter, fDeferredFormat, fDeferredArgs.data(), string_view(fContent.data(), fContent.size()));
+    }
+    return to_string(fContent);
+}
+
+bool Logger::Enqueue()
+{
+    if (AsyncWriter::fOnWriterThread) {
+        // lines logged by sinks on the writer thread are written directly
+        return false;
+    }
+
+    bool queued = false;
+    Hazards::Guard<AsyncWriter> guard(Hazards::asyncWriter, fAsyncWriter);
+    if (AsyncWriter* writer = guard.Get()) {
+        LogRecord record;
+        record.fInfos = fInfos;
+        record.fSite = fSite;
+        if (!fSite) {
+            record.fOrigin.reserve(fInfos.file.size() + fInfos.line.size() + fInfos.func.size());
+            record.fOrigin.append(fInfos.file).append(fInfos.line).append(fInfos.func);
+        }
+        record.fVerbosity = fLineVerbosity;
+        record.fContent.assign(fContent.data(), fContent.size());
+        if (fDeferredFormatter) {
+            record.fFormatter = fDeferredFormatter;
+            record.fFormat = fDeferredFormat;
+            record.fTypes = fDeferredTypes;
+            record.fArgs.assign(fDeferredArgs.data(), fDeferredArgs.size());
+        }
+        writer->Push(record);
+        queued = true;
+    }
+    return queued;
+}
+
+void Logger::Write(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, string_view content, const DeferredArgs& deferred, bool replay)
+{
+    if (!replay && fFlightRecorder.Triggers(infos.severity)) {
+        WriteFlightRecorder(infos.timestamp, infos.us);
+    }
+
+    // the plain prefix is rendered once and shared by the console and the file sink
+    const VSpec& spec = fVerbosities.at(static_cast<size_t>(verbosity));
+    fmt::memory_buffer prefix;
+    bool isRendered = false;
+    auto bwPrefix = [&]() -> string_view {
+        if (!isRendered) {
+            FormatPrefix(prefix, spec, infos, false, site);
+            isRendered = true;
+        }
+        return string_view(prefix.data(), prefix.size());
+    };
+
+    // deferred arguments are formatted only if a text sink needs them
+    string formatted;
+    bool isFormatted = false;
+    auto text = [&]() -> string_view {
+        if (!deferred.fFormatter) {
+            return content;
+        }
+        if (!isFormatted) {
+            formatted = FormatDeferred(deferred.fFormatter, deferred.fFormat, deferred.fArgs.data(), content);
+            isFormatted = true;
+        }
+        return formatted;
+    };
 
-            if (spec.fSize > 0) {
-                fmt::format_to(std::back_inserter(fBWPrefix), " ");
-            }
-        }
-
-        if (fColored && LoggingToConsole()) {
-            for (const auto info : spec.fInfos) {
-                switch (info) {
-                    case VSpec::Info::process_name:
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}]", ColorOut(Color::fgBlue, fInfos.process_name));
-                        break;
-                    case VSpec::Info::timestamp_us:
-                        FillTimeInfos();
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}{:%H:%M:%S}.{:06}{}]", startColor(Color::fgCyan), *std::localtime(&fInfos.timestamp), fInfos.us.count(), endColor());
-                        break;
-                    case VSpec::Info::timestamp_s:
-                        FillTimeInfos();
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}{:%H:%M:%S}{}]", startColor(Color::fgCyan), *std::localtime(&fInfos.timestamp), endColor());
-                        break;
-                    case VSpec::Info::severity:
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}]", GetColoredSeverityString(fInfos.severity));
-                        break;
-                    case VSpec::Info::file_line_function:
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}:{}:{}]", ColorOut(Color::fgBlue, fInfos.file), ColorOut(Color::fgYellow, fInfos.line), ColorOut(Color::fgBlue, fInfos.func));
-                        break;
-                    case VSpec::Info::file_line:
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}:{}]", ColorOut(Color::fgBlue, fInfos.file), ColorOut(Color::fgYellow, fInfos.line));
-                        break;
-                    case VSpec::Info::file:
-                        fmt::format_to(std::back_inserter(fColorPrefix), "[{}]", ColorOut(Color::fgBlue, fInfos.file));
-                        break;
-                    default:
-                        break;
+    // a line repeating the previous one of the sink is held back, the summary of the held back repeats is written first
+    auto held = [&](RepeatFilter& filter, auto&& writeRepeats) {
+        if (!filter.Enabled()) {
+            return false;
+        }
+        optional<RepeatFilter::Summary> summary;
+        const bool isHeld = filter.Hold(infos, site, verbosity, text(), summary);
+        if (summary) {
+            writeRepeats(*summary);
+        }
+        return isHeld;
+    };
+
+    // no reader at all while no custom sink takes the line
+    if (!replay && LoggingCustom(infos.severity, fCustomSinksSeverity.load(memory_order_relaxed))) {
+        // custom sinks got recorded lines already, according to their own severities
+        CustomSinks::Reader reader(fCustomSinks);
+        const CustomSinks::Snapshot* sinks = reader.Get();
+        if (sinks) {
+            // a std::string copy of the content is built only for sinks with the original signature
+            optional<string> str;
+            for (CustomSinks::Sink* sink : sinks->fPlan[static_cast<size_t>(infos.severity)]) {
+                if (held(sink->fRepeats, [&](RepeatFilter::Summary& summary) { fCustomSinks.Send(*sink, summary.Metadata(), summary.fSite, summary.fRecord.content); })) {
+                    continue;
                 }
+                if (SinkWorker* worker = sink->fWorker.load(memory_order_acquire)) {
+                    worker->Push(infos, site, text());
+                    continue;
+                }
+                lock_guard<mutex> lock(sink->fMtx);
+                CustomSinks::Written(*sink);
+                try {
+                    if (sink->fViewFunc) {
+                        sink->fViewFunc(text(), infos);
+                    } else if (sink->fBatchFunc) {
+                        fCustomSinks.Append(*sink, infos, site, text());
+                    } else {
+                        if (!str) {
+                            str.emplace(text());
+                        }
+                        sink->fFunc(*str, infos);
+                    }
+                } catch (...) {
+                    CustomSinks::Failed(*sink);
+                    throw;
+                }
+            }
+        }
+    }
+
+    // sites enabled in the call site registry bypass the console and file thresholds
+    const bool forced = site && site->GetState() == CallSite::State::enabled;
+    // recorded lines go to every active sink
+    auto replayTo = [&](const atomic<Severity>& threshold) { return replay && threshold.load(memory_order_relaxed) != Severity::nolog; };
+
+    if (forced || LoggingToConsole(infos.severity) || replayTo(fConsoleSeverity)) {
+        if (!held(fConsoleRepeats, [](RepeatFilter::Summary& summary) { WriteRepeats(true, summary.Metadata(), summary.fSite, summary.fVerbosity, summary.fRecord.content); })) {
+            const bool colored = fColored.load(memory_order_relaxed);
+            WriteToConsole(spec, infos, site, colored, colored ? string_view() : bwPrefix(), text());
+        }
+    }
+
+    if (forced || LoggingToFile(infos.severity) || replayTo(fFileSeverity)) {
+        if (!held(fFileRepeats, [](RepeatFilter::Summary& summary) { WriteRepeats(false, summary.Metadata(), summary.fSite, summary.fVerbosity, summary.fRecord.content); })) {
+            WriteToFile(infos, site, bwPrefix(), text());
+        }
+    }
+
+    if (LoggingToRingFile(infos.severity) || replayTo(fRingFileSeverity)) {
+        fStats.Written(StatsCollector::ringFile);
+        fRingFileSink.Write(bwPrefix(), text());
+    }
+
+    if (LoggingToBinaryFile(infos.severity) || replayTo(fBinaryFileSeverity)) {
+        lock_guard<mutex> lock(fMtx);
+        if (fBinaryFileSink.IsOpen()) {
+            fStats.Written(StatsCollector::binaryFile);
+            if (deferred.fFormatter && BinaryFileSink::Encodable(deferred.fTypes)) {
+                fBinaryFileSink.Write(infos, site, content, &deferred);
+            } else {
+                fBinaryFileSink.Write(infos, site, text(), nullptr);
+            }
+        }
+    }
+}
+
+void Logger::WriteToConsole(const VSpec& spec, const ExtendedLogMetaData& infos, const CallSite* site, bool colored, string_view prefix, string_view text)
+{
+    fStats.Written(StatsCollector::console);
+    if (fConsoleOutput.load(memory_order_relaxed) == ConsoleOutput::direct) {
+        fmt::memory_buffer line;
+        if (colored) {
+            FormatPrefix(line, spec, infos, true, site);
+        } else {
+            line.append(prefix);
+        }
+        line.append(text);
+        line.push_back('\n');
+        // written to the descriptor, nothing to flush
+        fConsoleWriter.Write(infos.severity, string_view(line.data(), line.size()));
+        return;
+    }
+    // "\n" + flush instead of endl makes output thread safe.
+    if (colored) {
+        fmt::memory_buffer colorPrefix;
+        FormatPrefix(colorPrefix, spec, infos, true, site);
+        fmt::print("{}{}\n", string_view(colorPrefix.data(), colorPrefix.size()), text);
+    } else {
+        fmt::print("{}{}\n", prefix, text);
+    }
+    cout << flush;
+}
+
+void Logger::WriteToFile(const ExtendedLogMetaData& infos, const CallSite* site, string_view prefix, string_view text)
+{
+    fStats.Written(StatsCollector::file);
+    fmt::memory_buffer buffer;
+    buffer.append(prefix);
+    buffer.append(text);
+    buffer.push_back('\n');
+    const string_view line(buffer.data(), buffer.size());
+    Hazards::Guard<SinkWorker> guard(Hazards::fileWorker, fFileWorker);
+    if (SinkWorker* worker = guard.Get()) {
+        worker->Push(infos, site, line);
+    } else {
+        fFileWriter.Write(infos.severity, line);
+    }
+}
+
+void Logger::WriteRepeats(bool console, const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, string_view summary)
+{
+    const VSpec& spec = fVerbosities.at(static_cast<size_t>(verbosity));
+    const bool colored = console && fColored.load(memory_order_relaxed);
+    fmt::memory_buffer prefix;
+    if (!colored) {
+        FormatPrefix(prefix, spec, infos, false, site);
+    }
+    if (console) {
+        WriteToConsole(spec, infos, site, colored, string_view(prefix.data(), prefix.size()), summary);
+    } else {
+        WriteToFile(infos, site, string_view(prefix.data(), prefix.size()), summary);
+    }
+}
+
+void Logger::WriteRepeats()
+{
+    if (auto summary = fConsoleRepeats.Take()) {
+        WriteRepeats(true, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+    if (auto summary = fFileRepeats.Take()) {
+        WriteRepeats(false, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+    CustomSinks::Reader reader(fCustomSinks);
+    if (const CustomSinks::Snapshot* sinks = reader.Get()) {
+        for (const auto& entry : sinks->fEntries) {
+            if (auto summary = entry.fSink->fRepeats.Take()) {
+                fCustomSinks.Send(*entry.fSink, summary->Metadata(), summary->fSite, summary->fRecord.content);
             }
+        }
+    }
+}
+
+chrono::steady_clock::time_point Logger::WriteExpiredRepeats()
+{
+    auto next = chrono::steady_clock::time_point::max();
+    const auto now = chrono::steady_clock::now();
+    if (auto summary = fConsoleRepeats.TakeExpired(now, next)) {
+        WriteRepeats(true, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+    if (auto summary = fFileRepeats.TakeExpired(now, next)) {
+        WriteRepeats(false, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+    CustomSinks::Reader reader(fCustomSinks);
+    if (const CustomSinks::Snapshot* sinks = reader.Get()) {
+        for (const auto& entry : sinks->fEntries) {
+            if (auto summary = entry.fSink->fRepeats.TakeExpired(now, next)) {
+                fCustomSinks.Send(*entry.fSink, summary->Metadata(), summary->fSite, summary->fRecord.content);
+            }
+        }
+    }
+    return next;
+}
+
+struct Logger::RepeatTimer
+{
+    mutex fMtx;
+    condition_variable fWakeUp;
+    bool fStop = false;
+    bool fNewRepeat = false; // a first repeat was held back since the last check
+    thread fThread;
+};
 
-            if (spec.fSize > 0) {
-                fmt::format_to(std::back_inserter(fColorPrefix), " ");
+void Logger::StartRepeatTimer()
+{
+    lock_guard<mutex> lock(fMtx);
+    if (fRepeatTimer.load()) {
+        return;
+    }
+    auto timer = new RepeatTimer();
+    timer->fThread = thread([timer]() {
+        unique_lock<mutex> timerLock(timer->fMtx);
+        while (!timer->fStop) {
+            timer->fNewRepeat = false;
+            timerLock.unlock();
+            const auto next = WriteExpiredRepeats();
+            timerLock.lock();
+            if (timer->fStop) {
+                break;
             }
+            // repeats held back in the meantime may time out earlier
+            auto woken = [&]() { return timer->fStop || timer->fNewRepeat; };
+            if (next == chrono::steady_clock::time_point::max()) {
+                timer->fWakeUp.wait(timerLock, woken);
+            } else {
+                timer->fWakeUp.wait_until(timerLock, next, woken);
+            }
+        }
+    });
+    fRepeatTimer.store(timer);
+}
+
+void Logger::StopRepeatTimer()
+{
+    unique_ptr<RepeatTimer> timer(fRepeatTimer.exchange(nullptr));
+    if (timer) {
+        {
+            lock_guard<mutex> lock(timer->fMtx);
+            timer->fStop = true;
+        }
+        timer->fWakeUp.notify_one();
+        timer->fThread.join();
+    }
+}
+
+void Logger::NotifyRepeatTimer()
+{
+    if (RepeatTimer* timer = fRepeatTimer.load()) {
+        {
+            lock_guard<mutex> lock(timer->fMtx);
+            timer->fNewRepeat = true;
         }
+        timer->fWakeUp.notify_one();
+    }
+}
+
+void Logger::WriteFlightRecorder(time_t timestamp, chrono::microseconds us)
+{
+    for (const auto& item : fFlightRecorder.Take(timestamp, us)) {
+        Write(item.fRecord.metadata, item.fSite, item.fVerbosity, item.fRecord.content, {}, true);
+    }
+}
+
+void Logger::SetFlightRecorder(Severity recordSeverity, Severity triggerSeverity, size_t capacity)
+{
+    if (recordSeverity < Severity::FAIR_MIN_SEVERITY && recordSeverity != Severity::nolog) {
+        cout << "Requested flight recorder severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), setting to " << Severity::FAIR_MIN_SEVERITY << endl;
+        recordSeverity = Severity::FAIR_MIN_SEVERITY;
+    }
+    fFlightRecorder.Configure(recordSeverity, triggerSeverity, capacity);
+    UpdateMinSeverity();
+}
+
+void Logger::DumpFlightRecorder()
+{
+    WriteFlightRecorder(numeric_limits<time_t>::max(), chrono::microseconds(0));
+}
 
-        if (!fCustomSinks.empty()) {
-            FillTimeInfos();
-        }
+void Logger::StartAsync(size_t queueCapacity, AsyncQueues queues)
+{
+    if (fAsyncWriter.load() != nullptr) {
+        cout << "Logger::StartAsync: asynchronous mode is already active, ignoring" << endl;
+        return;
     }
+    fAsyncWriter.store(new AsyncWriter(queueCapacity, queues));
 }
 
-Logger::~Logger() noexcept(false)
+void Logger::StopAsync()
 {
-    if (fIsDestructed) {
-        printf("post-static destruction output: %s\n", fContent.str().c_str());
+    unique_ptr<AsyncWriter> writer(fAsyncWriter.exchange(nullptr));
+    if (!writer) {
         return;
     }
+    // wait for threads that are still handing over records to the old writer
+    Hazards::WaitUnused(Hazards::asyncWriter, writer.get());
+    writer->Stop();
+}
 
-    for (auto& it : fCustomSinks) {
-        if (LoggingCustom(it.second.first)) {
-            lock_guard<mutex> lock(fMtx);
-            it.second.second(fContent.str(), fInfos);
-        }
+void Logger::Flush()
+{
+    if (AsyncWriter::fOnWriterThread) {
+        return;
     }
 
-    // "\n" + flush instead of endl makes output thread safe.
-
-    if (LoggingToConsole()) {
-        if (fColored) {
-            fmt::print("{}{}\n", to_string(fColorPrefix), fContent.str());
-        } else {
-            fmt::print("{}{}\n", to_string(fBWPrefix), fContent.str());
+    {
+        Hazards::Guard<AsyncWriter> guard(Hazards::asyncWriter, fAsyncWriter);
+        if (AsyncWriter* writer = guard.Get()) {
+            writer->Flush();
         }
-        cout << flush;
     }
 
-    if (LoggingToFile()) {
-        lock_guard<mutex> lock(fMtx);
-        if (fFileStream.is_open()) {
-            fFileStream << fmt::format("{}{}\n", to_string(fBWPrefix), fContent.str()) << flush;
+    WriteRepeats();
+    FlushSinkWorkers();
+    fCustomSinks.FlushBatches(true);
+    fConsoleWriter.Flush();
+    fFileWriter.Flush();
+    fRingFileSink.Flush();
+    lock_guard<mutex> lock(fMtx);
+    fBinaryFileSink.Flush();
+}
+
+void Logger::FlushSinkWorkers()
+{
+    {
+        Hazards::Guard<SinkWorker> guard(Hazards::fileWorker, fFileWorker);
+        if (SinkWorker* worker = guard.Get()) {
+            worker->Flush();
         }
     }
 
-    if (fInfos.severity == Severity::fatal) {
-        if (fFatalCallback) {
-            fFatalCallback();
+    // the snapshot keeps the workers alive while they are flushed
+    CustomSinks::Reader reader(fCustomSinks);
+    const CustomSinks::Snapshot* sinks = reader.Get();
+    if (sinks) {
+        for (const auto& entry : sinks->fEntries) {
+            if (SinkWorker* worker = entry.fSink->fWorker.load(memory_order_acquire)) {
+                worker->Flush();
+            }
         }
     }
 }
 
+void Logger::StopSinkThreads()
+{
+    StopRepeatTimer();
+    WriteRepeats();
+    fCustomSinks.StopBatchTimer();
+    SetFileSinkQueue(0);
+    FlushSinkWorkers();
+    fCustomSinks.FlushBatches(true);
+}
+
 void Logger::LogEmptyLine()
 {
     // do nothing, line break is added by the destructor
@@ -332,7 +1777,7 @@ void Logger::SetConsoleSeverity(const string& severityStr)
 
 Severity Logger::GetConsoleSeverity()
 {
-    return fConsoleSeverity;
+    return fConsoleSeverity.load();
 }
 
 void Logger::SetFileSeverity(const Severity severity)
@@ -362,8 +1807,23 @@ void Logger::SetCustomSeverity(const string& key, const Severity severity)
             cout << "Requested severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), ignoring" << endl;
             return;
         }
-        fCustomSinks.at(key).first = severity;
-        UpdateMinSeverity();
+        unique_ptr<const CustomSinks::Snapshot> previous;
+        {
+            lock_guard<mutex> lock(fMtx);
+            const CustomSinks::Snapshot* current = fCustomSinks.Current();
+            if (!current || !current->Find(key)) {
+                throw out_of_range("no custom sink with key " + key);
+            }
+            vector<CustomSinks::Entry> entries(current->fEntries);
+            for (auto& entry : entries) {
+                if (entry.fKey == key) {
+                    entry.fSeverity = severity;
+                }
+            }
+            previous = fCustomSinks.Publish(std::move(entries));
+            UpdateCustomSinksSeverity();
+        }
+        fCustomSinks.Retire(std::move(previous));
     } catch (const out_of_range& oor) {
         LOG(error) << "No custom sink with id '" << key << "' found";
         throw;
@@ -383,7 +1843,13 @@ void Logger::SetCustomSeverity(const string& key, const string& severityStr)
 Severity Logger::GetCustomSeverity(const std::string& key)
 {
     try {
-        return fCustomSinks.at(key).first;
+        lock_guard<mutex> lock(fMtx);
+        const CustomSinks::Snapshot* current = fCustomSinks.Current();
+        const CustomSinks::Entry* entry = current ? current->Find(key) : nullptr;
+        if (!entry) {
+            throw out_of_range("no custom sink with key " + key);
+        }
+        return entry->fSeverity;
     } catch (const out_of_range& oor) {
         LOG(error) << "No custom sink with id '" << key << "' found";
         throw;
@@ -392,13 +1858,13 @@ Severity Logger::GetCustomSeverity(const std::string& key)
 
 void Logger::CycleConsoleSeverityUp()
 {
-    int current = static_cast<int>(fConsoleSeverity);
+    int current = static_cast<int>(fConsoleSeverity.load());
     if (current == static_cast<int>(fSeverityNames.size()) - 1) {
         SetConsoleSeverity(Severity::FAIR_MIN_SEVERITY);
     } else {
         SetConsoleSeverity(static_cast<Severity>(current + 1));
     }
-    int newCurrent = static_cast<int>(fConsoleSeverity);
+    int newCurrent = static_cast<int>(fConsoleSeverity.load());
     stringstream ss;
 
     for (int i = 0; i < static_cast<int>(fSeverityNames.size()); ++i) {
@@ -411,13 +1877,13 @@ void Logger::CycleConsoleSeverityUp()
 
 void Logger::CycleConsoleSeverityDown()
 {
-    int current = static_cast<int>(fConsoleSeverity);
+    int current = static_cast<int>(fConsoleSeverity.load());
     if (current == static_cast<int>(Severity::FAIR_MIN_SEVERITY)) {
         SetConsoleSeverity(static_cast<Severity>(fSeverityNames.size() - 1));
     } else {
         SetConsoleSeverity(static_cast<Severity>(current - 1));
     }
-    int newCurrent = static_cast<int>(fConsoleSeverity);
+    int newCurrent = static_cast<int>(fConsoleSeverity.load());
     stringstream ss;
 
     for (int i = 0; i < static_cast<int>(fSeverityNames.size()); ++i) {
@@ -430,13 +1896,13 @@ void Logger::CycleConsoleSeverityDown()
 
 void Logger::CycleVerbosityUp()
 {
-    int current = static_cast<int>(fVerbosity);
+    int current = static_cast<int>(fVerbosity.load());
     if (current == static_cast<int>(fVerbosityNames.size() - 1)) {
         SetVerbosity(static_cast<Verbosity>(0));
     } else {
         SetVerbosity(static_cast<Verbosity>(current + 1));
     }
-    int newCurrent = static_cast<int>(fVerbosity);
+    int newCurrent = static_cast<int>(fVerbosity.load());
     stringstream ss;
 
     for (int i = 0; i < static_cast<int>(fVerbosityNames.size()); ++i) {
@@ -449,13 +1915,13 @@ void Logger::CycleVerbosityUp()
 
 void Logger::CycleVerbosityDown()
 {
-    int current = static_cast<int>(fVerbosity);
+    int current = static_cast<int>(fVerbosity.load());
     if (current == 0) {
         SetVerbosity(static_cast<Verbosity>(fVerbosityNames.size() - 1));
     } else {
         SetVerbosity(static_cast<Verbosity>(current - 1));
     }
-    int newCurrent = static_cast<int>(fVerbosity);
+    int newCurrent = static_cast<int>(fVerbosity.load());
     stringstream ss;
 
     for (int i = 0; i < static_cast<int>(fVerbosityNames.size()); ++i) {
@@ -468,19 +1934,39 @@ void Logger::CycleVerbosityDown()
 
 void Logger::UpdateMinSeverity()
 {
-    if (fFileSeverity == Severity::nolog) {
-        fMinSeverity = fConsoleSeverity;
+    lock_guard<mutex> lock(fSeverityMtx);
+
+    Severity minSeverity;
+    const Severity consoleSeverity = fConsoleSeverity.load();
+    const Severity fileSeverity = fFileSeverity.load();
+    if (fileSeverity == Severity::nolog) {
+        minSeverity = consoleSeverity;
     } else {
-        fMinSeverity = std::max(fConsoleSeverity, fFileSeverity);
+        minSeverity = std::max(consoleSeverity, fileSeverity);
     }
 
-    for (auto& it : fCustomSinks) {
-        if (fMinSeverity == Severity::nolog) {
-            fMinSeverity = std::max(fMinSeverity, it.second.first);
-        } else if (it.second.first != Severity::nolog) {
-            fMinSeverity = std::min(fMinSeverity, it.second.first);
+    auto include = [&](Severity severity) {
+        if (minSeverity == Severity::nolog) {
+            minSeverity = std::max(minSeverity, severity);
+        } else if (severity != Severity::nolog) {
+            minSeverity = std::min(minSeverity, severity);
         }
-    }
+    };
+
+    include(fBinaryFileSeverity.load());
+    include(fRingFileSeverity.load());
+    include(fFlightRecorder.RecordSeverity());
+    include(fCustomSinksSeverity.load());
+
+    fMinSeverity.store(minSeverity == Severity::nolog ? Severity::fatal : minSeverity, memory_order_relaxed);
+}
+
+// to be called with fMtx held
+void Logger::UpdateCustomSinksSeverity()
+{
+    const CustomSinks::Snapshot* current = fCustomSinks.Current();
+    fCustomSinksSeverity = current ? current->MinSeverity() : Severity::nolog;
+    UpdateMinSeverity();
 }
 
 bool Logger::Logging(const string& severityStr)
@@ -515,7 +2001,7 @@ Verbosity Logger::GetVerbosity()
 
 void Logger::DefineVerbosity(const Verbosity verbosity, const VerbositySpec spec)
 {
-    fVerbosities[verbosity] = spec;
+    fVerbosities.at(static_cast<size_t>(verbosity)) = spec;
 }
 
 void Logger::DefineVerbosity(const string& verbosityStr, const VerbositySpec spec)
@@ -527,36 +2013,78 @@ void Logger::DefineVerbosity(const string& verbosityStr, const VerbositySpec spe
     }
 }
 
-void Logger::SetConsoleColor(const bool colored)
+void Logger::SetConsoleOutput(const ConsoleOutput output)
 {
-    fColored = colored;
+    // what was written through stdout so far goes first
+    cout << flush;
+    fflush(stdout);
+    if (output == ConsoleOutput::stdio) {
+        fConsoleWriter.Flush();
+    }
+    fConsoleOutput = output;
 }
 
-string Logger::InitFileSink(const Severity severity, const string& filename, bool customizeName)
+void Logger::SetConsoleFlushPolicy(const FlushPolicy& policy)
 {
-    lock_guard<mutex> lock(fMtx);
-    if (fFileStream.is_open()) {
-        fFileStream.close();
+    fConsoleWriter.SetPolicy(policy);
+}
+
+void Logger::SetFileFlushPolicy(const FlushPolicy& policy)
+{
+    fFileWriter.SetPolicy(policy);
+}
+
+void Logger::SetFileRotation(const RotationPolicy& policy)
+{
+    fFileWriter.SetRotation(policy);
+}
+
+bool Logger::SetFileCompression(bool compress)
+{
+    if (!fFileWriter.SetCompression(compress)) {
+        cout << "File compression requested, but FairLogger was built without zlib" << endl;
+        return false;
     }
+    return true;
+}
 
-    string fullName = filename;
+void Logger::SetConsoleColor(const bool colored)
+{
+    fColored = colored;
+}
 
-    if (customizeName) {
-        // TODO: customize file name
-        auto now = chrono::system_clock::to_time_t(chrono::system_clock::now());
-        stringstream ss;
-        ss << "_";
-        char tsstr[32];
-        if (strftime(tsstr, sizeof(tsstr), "%Y-%m-%d_%H_%M_%S", localtime(&now))) {
-            ss << tsstr;
+void Logger::SetClockSource(const ClockSource source)
+{
+    if (source == ClockSource::coarse) {
+#ifndef CLOCK_REALTIME_COARSE
+        cout << "Logger::SetClockSource: CLOCK_REALTIME_COARSE is not available on this platform, using the precise clock" << endl;
+        fClockSource = ClockSource::precise;
+        return;
+#endif
+    } else if (source == ClockSource::tsc) {
+#ifdef FAIR_LOGGER_HAVE_TSC
+        static const bool calibrated = CalibrateTsc();
+        if (!calibrated) {
+            cout << "Logger::SetClockSource: no invariant time stamp counter found, using the precise clock" << endl;
+            fClockSource = ClockSource::precise;
+            return;
         }
-        ss << ".log";
-        fullName += ss.str();
+#else
+        cout << "Logger::SetClockSource: time stamp counter is not supported on this platform, using the precise clock" << endl;
+        fClockSource = ClockSource::precise;
+        return;
+#endif
     }
+    fClockSource = source;
+}
 
-    fFileStream.open(fullName, fstream::out | fstream::app);
+string Logger::InitFileSink(const Severity severity, const string& filename, bool customizeName)
+{
+    Flush(); // queued lines still belong to the previous file
+    lock_guard<mutex> lock(fMtx);
+    string fullName = customizeName ? CustomizedFileName(filename, fFileWriter.GetCompression() ? ".log.gz" : ".log") : filename;
 
-    if (fFileStream.is_open()) {
+    if (fFileWriter.Open(fullName)) {
         if (severity < Severity::FAIR_MIN_SEVERITY && severity != Severity::nolog) {
             cout << "Requested file sink severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), setting to " << Severity::FAIR_MIN_SEVERITY << endl;
             fFileSeverity = Severity::FAIR_MIN_SEVERITY;
@@ -581,35 +2109,161 @@ string Logger::InitFileSink(const string& severityStr, const string& filename, b
     }
 }
 
+string Logger::CustomizedFileName(const string& filename, const string& extension)
+{
+    auto now = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    stringstream ss;
+    ss << filename << "_";
+    char tsstr[32];
+    if (strftime(tsstr, sizeof(tsstr), "%Y-%m-%d_%H_%M_%S", localtime(&now))) {
+        ss << tsstr;
+    }
+    ss << extension;
+    return ss.str();
+}
+
+string Logger::InitBinaryFileSink(const Severity severity, const string& filename, bool customizeName)
+{
+    Flush(); // queued lines still belong to the previous file
+    lock_guard<mutex> lock(fMtx);
+
+    string fullName = customizeName ? CustomizedFileName(filename, ".flog") : filename;
+
+    if (fBinaryFileSink.Open(fullName)) {
+        if (severity < Severity::FAIR_MIN_SEVERITY && severity != Severity::nolog) {
+            cout << "Requested binary file sink severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), setting to " << Severity::FAIR_MIN_SEVERITY << endl;
+            fBinaryFileSeverity = Severity::FAIR_MIN_SEVERITY;
+        } else {
+            fBinaryFileSeverity = severity;
+        }
+        UpdateMinSeverity();
+    } else {
+        cout << "Error opening file: " << fullName;
+    }
+
+    return fullName;
+}
+
+string Logger::InitBinaryFileSink(const string& severityStr, const string& filename, bool customizeName)
+{
+    if (fSeverityMap.count(severityStr)) {
+        return InitBinaryFileSink(fSeverityMap.at(severityStr), filename, customizeName);
+    } else {
+        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
+        return InitBinaryFileSink(Severity::info, filename);
+    }
+}
+
+void Logger::RemoveBinaryFileSink()
+{
+    Flush();
+    lock_guard<mutex> lock(fMtx);
+    if (fBinaryFileSink.IsOpen()) {
+        fBinaryFileSink.Close();
+        fBinaryFileSeverity = Severity::nolog;
+        UpdateMinSeverity();
+    }
+}
+
+string Logger::InitRingFileSink(const Severity severity, const string& filename, size_t size, bool customizeName)
+{
+    lock_guard<mutex> lock(fMtx);
+
+    string fullName = customizeName ? CustomizedFileName(filename, ".ring") : filename;
+
+    if (fRingFileSink.Open(fullName, size)) {
+        if (severity < Severity::FAIR_MIN_SEVERITY && severity != Severity::nolog) {
+            cout << "Requested ring file sink severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), setting to " << Severity::FAIR_MIN_SEVERITY << endl;
+            fRingFileSeverity = Severity::FAIR_MIN_SEVERITY;
+        } else {
+            fRingFileSeverity = severity;
+        }
+        UpdateMinSeverity();
+    } else {
+        cout << "Error opening file: " << fullName;
+    }
+
+    return fullName;
+}
+
+string Logger::InitRingFileSink(const string& severityStr, const string& filename, size_t size, bool customizeName)
+{
+    if (fSeverityMap.count(severityStr)) {
+        return InitRingFileSink(fSeverityMap.at(severityStr), filename, size, customizeName);
+    } else {
+        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
+        return InitRingFileSink(Severity::info, filename, size);
+    }
+}
+
+void Logger::RemoveRingFileSink()
+{
+    Flush();
+    lock_guard<mutex> lock(fMtx);
+    if (fRingFileSink.IsOpen()) {
+        fRingFileSink.Close();
+        fRingFileSeverity = Severity::nolog;
+        UpdateMinSeverity();
+    }
+}
+
 void Logger::RemoveFileSink()
 {
+    Flush();
     lock_guard<mutex> lock(fMtx);
-    if (fFileStream.is_open()) {
-        fFileStream.close();
+    if (fFileWriter.IsOpen()) {
+        fFileWriter.Close();
         fFileSeverity = Severity::nolog;
         UpdateMinSeverity();
     }
 }
 
-bool Logger::LoggingToConsole() const
+bool Logger::LoggingToConsole(const Severity severity)
+{
+    const Severity threshold = fConsoleSeverity.load(memory_order_relaxed);
+    return (severity >= threshold &&
+            threshold > Severity::nolog) ||
+            severity == Severity::fatal;
+}
+
+bool Logger::LoggingToFile(const Severity severity)
+{
+    const Severity threshold = fFileSeverity.load(memory_order_relaxed);
+    return (severity >= threshold &&
+            threshold > Severity::nolog) ||
+            severity == Severity::fatal;
+}
+
+bool Logger::LoggingToBinaryFile(const Severity severity)
+{
+    const Severity threshold = fBinaryFileSeverity.load(memory_order_relaxed);
+    return (severity >= threshold &&
+            threshold > Severity::nolog) ||
+            severity == Severity::fatal;
+}
+
+bool Logger::LoggingToRingFile(const Severity severity)
 {
-    return (fInfos.severity >= fConsoleSeverity &&
-            fConsoleSeverity > Severity::nolog) ||
-            fInfos.severity == Severity::fatal;
+    const Severity threshold = fRingFileSeverity.load(memory_order_relaxed);
+    return (severity >= threshold &&
+            threshold > Severity::nolog) ||
+            severity == Severity::fatal;
 }
 
-bool Logger::LoggingToFile() const
+bool Logger::Written(const Severity severity, const CallSite* site)
 {
-    return (fInfos.severity >= fFileSeverity &&
-            fFileSeverity   >  Severity::nolog) ||
-            fInfos.severity == Severity::fatal;
+    return (site && site->GetState() == CallSite::State::enabled)
+        || LoggingToConsole(severity)
+        || LoggingToFile(severity)
+        || LoggingToRingFile(severity)
+        || LoggingToBinaryFile(severity);
 }
 
-bool Logger::LoggingCustom(const Severity severity) const
+bool Logger::LoggingCustom(const Severity severity, const Severity sinkSeverity)
 {
-    return (fInfos.severity >= severity &&
-            severity        > Severity::nolog) ||
-            fInfos.severity == Severity::fatal;
+    return (severity >= sinkSeverity &&
+            sinkSeverity > Severity::nolog) ||
+            severity == Severity::fatal;
 }
 
 void Logger::OnFatal(function<void()> func)
@@ -619,37 +2273,264 @@ void Logger::OnFatal(function<void()> func)
 
 void Logger::AddCustomSink(const string& key, Severity severity, function<void(const string& content, const LogMetaData& metadata)> func)
 {
-    lock_guard<mutex> lock(fMtx);
-    if (fCustomSinks.count(key) == 0) {
+    InsertCustomSink(key, severity, make_shared<CustomSink>(CustomSink::Func(std::move(func))));
+}
+
+void Logger::AddCustomSink(const string& key, const string& severityStr, function<void(const string& content, const LogMetaData& metadata)> func)
+{
+    if (fSeverityMap.count(severityStr)) {
+        AddCustomSink(key, fSeverityMap.at(severityStr), func);
+    } else {
+        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
+        AddCustomSink(key, Severity::info, func);
+    }
+}
+
+void Logger::AddCustomSink(const string& key, Severity severity, function<void(string_view content, const ExtendedLogMetaData& metadata)> func)
+{
+    InsertCustomSink(key, severity, make_shared<CustomSink>(CustomSink::ViewFunc(std::move(func))));
+}
+
+void Logger::AddCustomSink(const string& key, const string& severityStr, function<void(string_view content, const ExtendedLogMetaData& metadata)> func)
+{
+    if (fSeverityMap.count(severityStr)) {
+        AddCustomSink(key, fSeverityMap.at(severityStr), func);
+    } else {
+        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
+        AddCustomSink(key, Severity::info, func);
+    }
+}
+
+void Logger::AddCustomBatchSink(const string& key, Severity severity, size_t maxRecords, chrono::microseconds maxDelay, function<void(const vector<CustomSinkRecord>& records)> func)
+{
+    InsertCustomSink(key, severity, make_shared<CustomSink>(std::move(func), maxRecords, maxDelay));
+}
+
+void Logger::AddCustomBatchSink(const string& key, const string& severityStr, size_t maxRecords, chrono::microseconds maxDelay, function<void(const vector<CustomSinkRecord>& records)> func)
+{
+    if (fSeverityMap.count(severityStr)) {
+        AddCustomBatchSink(key, fSeverityMap.at(severityStr), maxRecords, maxDelay, func);
+    } else {
+        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
+        AddCustomBatchSink(key, Severity::info, maxRecords, maxDelay, func);
+    }
+}
+
+void Logger::InsertCustomSink(const string& key, Severity severity, shared_ptr<CustomSink> sink)
+{
+    unique_lock<mutex> lock(fMtx);
+    const CustomSinks::Snapshot* current = fCustomSinks.Current();
+    if (!current || !current->Find(key)) {
+        const bool batch = static_cast<bool>(sink->fBatchFunc);
+        vector<CustomSinks::Entry> entries;
+        if (current) {
+            entries = current->fEntries;
+        }
         if (severity < Severity::FAIR_MIN_SEVERITY && severity != Severity::nolog) {
             cout << "Requested custom sink severity is higher than the enabled compile-time FAIR_MIN_SEVERITY (" << Severity::FAIR_MIN_SEVERITY << "), setting to " << Severity::FAIR_MIN_SEVERITY << endl;
-            fCustomSinks.insert(make_pair(key, make_pair(Severity::FAIR_MIN_SEVERITY, func)));
+            entries.push_back({ key, Severity::FAIR_MIN_SEVERITY, std::move(sink) });
         } else {
-            fCustomSinks.insert(make_pair(key, make_pair(severity, func)));
+            entries.push_back({ key, severity, std::move(sink) });
         }
-        UpdateMinSeverity();
+        unique_ptr<const CustomSinks::Snapshot> previous = fCustomSinks.Publish(std::move(entries));
+        UpdateCustomSinksSeverity();
+        if (batch) {
+            fCustomSinks.StartBatchTimer();
+        }
+        lock.unlock();
+        fCustomSinks.Retire(std::move(previous));
     } else {
+        lock.unlock();
         cout << "Logger::AddCustomSink: sink '" << key << "' already exists, will not add again. Remove first with Logger::RemoveCustomSink(const string& key)" << endl;
         throw runtime_error("Adding a sink with a key that already exists. Remove first.");
     }
 }
 
-void Logger::AddCustomSink(const string& key, const string& severityStr, function<void(const string& content, const LogMetaData& metadata)> func)
+void Logger::SetCustomSinkQueue(const string& key, size_t capacity, OverflowPolicy policy)
 {
-    if (fSeverityMap.count(severityStr)) {
-        AddCustomSink(key, fSeverityMap.at(severityStr), func);
-    } else {
-        LOG(error) << "Unknown severity setting: '" << severityStr << "', setting to default 'info'.";
-        AddCustomSink(key, Severity::info, func);
+    unique_lock<mutex> lock(fMtx);
+    const CustomSinks::Snapshot* current = fCustomSinks.Current();
+    const CustomSinks::Entry* entry = current ? current->Find(key) : nullptr;
+    if (!entry) {
+        lock.unlock();
+        LOG(error) << "No custom sink with id '" << key << "' found";
+        throw out_of_range("no custom sink with key " + key);
+    }
+
+    shared_ptr<CustomSink> sink = entry->fSink;
+    SinkWorker* next = nullptr;
+    if (capacity > 0) {
+        CustomSink* target = sink.get(); // outlives the worker, which is owned by it
+        next = new SinkWorker(capacity, policy, sink->fDrops, [target](const CustomSinkRecord& record, const CallSite* site) {
+            fCustomSinks.Call(*target, record.metadata, site, record.content);
+        });
+    }
+    unique_ptr<SinkWorker> previous(sink->fWorker.exchange(next, memory_order_acq_rel));
+    lock.unlock();
+    fCustomSinks.Synchronize(); // nobody pushes to the previous worker any more
+    // writes what is still queued, outside of fMtx as the sink may log
+    previous.reset();
+}
+
+void Logger::SetFileSinkQueue(size_t capacity, OverflowPolicy policy)
+{
+    SinkWorker* next = nullptr;
+    if (capacity > 0) {
+        next = new SinkWorker(capacity, policy, fFileDrops, [](const CustomSinkRecord& record, const CallSite* /* site */) {
+            fFileWriter.Write(record.metadata.severity, record.content);
+        });
+    }
+    unique_ptr<SinkWorker> previous(fFileWorker.exchange(next));
+    if (previous) {
+        // wait for threads that are still handing over lines to the previous worker
+        Hazards::WaitUnused(Hazards::fileWorker, previous.get());
+    }
+}
+
+uint64_t Logger::GetCustomSinkDrops(const string& key)
+{
+    try {
+        lock_guard<mutex> lock(fMtx);
+        const CustomSinks::Snapshot* current = fCustomSinks.Current();
+        const CustomSinks::Entry* entry = current ? current->Find(key) : nullptr;
+        if (!entry) {
+            throw out_of_range("no custom sink with key " + key);
+        }
+        return entry->fSink->fDrops.load(memory_order_relaxed);
+    } catch (const out_of_range& oor) {
+        LOG(error) << "No custom sink with id '" << key << "' found";
+        throw;
+    }
+}
+
+uint64_t Logger::GetFileSinkDrops()
+{
+    return fFileDrops.load(memory_order_relaxed);
+}
+
+void Logger::SetThrottle(const ThrottlePolicy& policy)
+{
+    fThrottle.Configure(policy);
+}
+
+uint64_t Logger::GetThrottleDrops(Severity severity)
+{
+    return fThrottle.Drops(severity);
+}
+
+void Logger::ReportThrottle(int64_t now)
+{
+    array<uint64_t, 16> drops;
+    if (!fThrottle.Report(now, drops)) {
+        return;
+    }
+    string counts;
+    for (size_t i = 0; i < drops.size(); ++i) {
+        if (drops[i] > 0) {
+            fmt::format_to(back_inserter(counts), "{}{} {}", counts.empty() ? "" : ", ", drops[i], fSeverityNames.at(i));
+        }
+    }
+    Throttle::fReporting = true;
+    LOG(warn) << "Logger throttle dropped lines since the last report: " << counts;
+    Throttle::fReporting = false;
+}
+
+void Logger::SetStats(bool enabled)
+{
+    fStats.Enable(enabled);
+}
+
+Logger::Stats Logger::GetStats(bool reset)
+{
+    static_assert(tuple_size<decltype(Stats::logTime)>::value == StatsCollector::HistogramSize, "histogram sizes differ");
+    Stats stats;
+    stats.sinks = {
+        { "console", false, 0, fConsoleWriter.Errors(reset) },
+        { "file", false, 0, fFileWriter.Errors(reset) },
+        { "ring file", false, 0, 0 },
+        { "binary file", false, 0, 0 }
+    };
+    vector<StatsCollector::CustomSinkSlot> customSinks;
+    {
+        lock_guard<mutex> lock(fMtx);
+        stats.sinks.at(StatsCollector::binaryFile).errors = fBinaryFileSink.Errors(reset);
+        if (const CustomSinks::Snapshot* current = fCustomSinks.Current()) {
+            for (const auto& entry : current->fEntries) {
+                customSinks.push_back({ entry.fKey, entry.fSink->fStatsSlot });
+            }
+        }
+    }
+    fStats.Collect(stats, reset, customSinks);
+    return stats;
+}
+
+void Logger::SetConsoleRepeatSuppression(chrono::milliseconds timeout)
+{
+    if (timeout.count() > 0) {
+        StartRepeatTimer();
+    }
+    if (auto summary = fConsoleRepeats.Configure(timeout)) {
+        WriteRepeats(true, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+}
+
+void Logger::SetFileRepeatSuppression(chrono::milliseconds timeout)
+{
+    if (timeout.count() > 0) {
+        StartRepeatTimer();
+    }
+    if (auto summary = fFileRepeats.Configure(timeout)) {
+        WriteRepeats(false, summary->Metadata(), summary->fSite, summary->fVerbosity, summary->fRecord.content);
+    }
+}
+
+void Logger::SetCustomSinkRepeatSuppression(const string& key, chrono::milliseconds timeout)
+{
+    unique_lock<mutex> lock(fMtx);
+    const CustomSinks::Snapshot* current = fCustomSinks.Current();
+    const CustomSinks::Entry* entry = current ? current->Find(key) : nullptr;
+    if (!entry) {
+        lock.unlock();
+        LOG(error) << "No custom sink with id '" << key << "' found";
+        throw out_of_range("no custom sink with key " + key);
+    }
+    shared_ptr<CustomSink> sink = entry->fSink;
+    lock.unlock();
+    if (timeout.count() > 0) {
+        StartRepeatTimer();
+    }
+    // outside of fMtx, as the sink may log
+    if (auto summary = sink->fRepeats.Configure(timeout)) {
+        fCustomSinks.Send(*sink, summary->Metadata(), summary->fSite, summary->fRecord.content);
     }
 }
 
 void Logger::RemoveCustomSink(const string& key)
 {
-    if (fCustomSinks.count(key) > 0) {
-        fCustomSinks.erase(key);
-        UpdateMinSeverity();
+    unique_lock<mutex> lock(fMtx);
+    const CustomSinks::Snapshot* current = fCustomSinks.Current();
+    if (current && current->Find(key)) {
+        shared_ptr<CustomSink> removed = current->Find(key)->fSink;
+        vector<CustomSinks::Entry> entries;
+        for (const auto& entry : current->fEntries) {
+            if (entry.fKey != key) {
+                entries.push_back(entry);
+            }
+        }
+        unique_ptr<const CustomSinks::Snapshot> previous = fCustomSinks.Publish(std::move(entries));
+        UpdateCustomSinksSeverity();
+        lock.unlock();
+        fCustomSinks.Retire(std::move(previous));
+        if (auto summary = removed->fRepeats.Take()) {
+            fCustomSinks.Send(*removed, summary->Metadata(), summary->fSite, summary->fRecord.content);
+        }
+        if (removed->fBatchFunc) {
+            // lines that reached the sink before it was removed are still handed over
+            lock_guard<mutex> sinkLock(removed->fMtx);
+            CustomSinks::Deliver(*removed);
+        }
     } else {
+        lock.unlock();
         cout << "Logger::RemoveCustomSink: sink '" << key << "' doesn't exists, will not remove." << endl;
         throw runtime_error("Trying to remove a sink with a key that does not exist.");
     }
@@ -657,22 +2538,22 @@ void Logger::RemoveCustomSink(const string& key)
 
 Logger& Logger::operator<<(ios_base& (*manip) (ios_base&))
 {
-    fContent << manip;
+    Stream() << manip;
     return *this;
 }
 
 Logger& Logger::operator<<(ostream& (*manip) (ostream&))
 {
-    fContent << manip;
+    Stream() << manip;
     return *this;
 }
 
 void Logger::FillTimeInfos()
 {
     if (!fTimeCalculated) {
-        chrono::time_point<chrono::system_clock> now = chrono::system_clock::now();
-        fInfos.timestamp = chrono::system_clock::to_time_t(now);
-        fInfos.us = chrono::duration_cast<chrono::microseconds>(now.time_since_epoch()) % 1000000;
+        const int64_t now = ClockMicroseconds(fClockSource.load(memory_order_relaxed));
+        fInfos.timestamp = static_cast<time_t>(now / 1000000);
+        fInfos.us = chrono::microseconds(now % 1000000);
         fTimeCalculated = true;
     }
 }
@@ -32,21 +32,30 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
+#include <cstring> // std::memcpy
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <map>
+#include <memory> // shared_ptr
 #include <mutex>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <time.h> // time_t
+#include <tuple>
 #include <type_traits> // is_same
 #include <unordered_map>
 #include <string_view>
+#include <thread> // std::thread::id
 #include <utility> // pair
+#include <vector>
 
 namespace fair
 {
@@ -185,18 +194,139 @@ struct LogMetaData
     fair::Severity severity;
 };
 
+// metadata for custom sinks taking the content as std::string_view
+struct ExtendedLogMetaData : LogMetaData
+{
+    std::thread::id thread_id;       // thread that logged the line
+    std::chrono::nanoseconds steady; // std::chrono::steady_clock time of the line
+    int line_number;                 // line as integer (0 if unknown)
+    uint64_t sequence;               // increases by one with every line that reaches a custom sink
+};
+
+// one line handed to a batch sink (see Logger::AddCustomBatchSink)
+struct CustomSinkRecord
+{
+    std::string content;
+    ExtendedLogMetaData metadata;
+    std::string origin; // storage of file, line and func for lines not logged through a LOG macro
+};
+
+// Static description of a LOG call site, one per macro expansion (constant-initialized, no guard).
+// The [file], [file:line] and [file:line:function] blocks are rendered on first use and cached.
+class CallSite
+{
+  public:
+    enum class State : int
+    {
+        unregistered = 0, // not reached yet
+        severity,         // logs according to the severity thresholds (default)
+        enabled,          // always logs to console and file sink
+        disabled          // never logs (except fatal)
+    };
+
+    template<size_t F, size_t L, size_t N>
+    constexpr CallSite(const char (&file)[F], int line, const char (&lineStr)[L], const char (&func)[N])
+        : fFile(Basename(std::string_view(file, F - 1)))
+        , fLine(line)
+        , fLineStr(lineStr, L - 1)
+        , fFunc(func, N - 1)
+        , fLocations{{ nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }}
+        , fState(static_cast<int>(State::unregistered))
+    {}
+    CallSite(const CallSite&) = delete;
+    CallSite& operator=(const CallSite&) = delete;
+
+    static constexpr std::string_view Basename(std::string_view path)
+    {
+        size_t pos = path.rfind('/');
+        return pos == std::string_view::npos ? path : path.substr(pos + 1);
+    }
+
+    // rendered location block for VerbositySpec::Info::file, file_line or file_line_function
+    std::string_view Location(VerbositySpec::Info info, bool colored) const;
+
+    State GetState() const { return static_cast<State>(fState.load(std::memory_order_relaxed)); }
+    // adds the site to the call site registry and applies the matching rules, returns the resulting state
+    State Register() const;
+
+    const std::string_view fFile;
+    const int fLine;
+    const std::string_view fLineStr;
+    const std::string_view fFunc;
+
+  private:
+    mutable std::array<std::atomic<const std::string*>, 6> fLocations;
+    mutable std::atomic<int> fState;
+
+    friend class Logger;
+};
+
+// State of one LOG_EVERY_N, LOG_FIRST_N or LOG_EVERY_T call site. It has a cache line of its own, so that counting
+// skipped occurrences touches neither the logger nor other sites. The checks run only for lines of enabled severities.
+class alignas(64) RateLimit
+{
+  public:
+    constexpr RateLimit() : fCount(0), fNext(0) {}
+    RateLimit(const RateLimit&) = delete;
+    RateLimit& operator=(const RateLimit&) = delete;
+
+    // true for occurrence 1, n + 1, 2n + 1, ..., suppressed is set to the occurrences skipped before it
+    bool EveryN(uint64_t n, uint64_t& suppressed)
+    {
+        const uint64_t count = fCount.fetch_add(1, std::memory_order_relaxed);
+        if (n > 1 && count % n != 0) {
+            return false;
+        }
+        suppressed = count == 0 || n <= 1 ? 0 : n - 1;
+        return true;
+    }
+
+    // true for the first n occurrences, afterwards the check only reads the counter
+    bool FirstN(uint64_t n)
+    {
+        return fCount.load(std::memory_order_relaxed) < n && fCount.fetch_add(1, std::memory_order_relaxed) < n;
+    }
+
+    // true at most once per interval (in seconds), suppressed is set to the occurrences skipped before it
+    bool EveryT(double seconds, uint64_t& suppressed)
+    {
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = fNext.load(std::memory_order_relaxed);
+        if (now < next || !fNext.compare_exchange_strong(next, now + static_cast<int64_t>(seconds * 1e9), std::memory_order_relaxed)) {
+            fCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = fCount.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+  private:
+    std::atomic<uint64_t> fCount;
+    std::atomic<int64_t> fNext; // steady clock (ns) of the next line of LOG_EVERY_T
+};
+
 class Logger
 {
   public:
     Logger(Severity severity, Verbosity verbosity, std::string_view file, std::string_view line, std::string_view func);
     Logger(Severity severity, std::string_view file, std::string_view line, std::string_view func)
-        : Logger(severity, fVerbosity, file, line, func)
+        : Logger(severity, fVerbosity.load(std::memory_order_relaxed), file, line, func)
+    {}
+    Logger(Severity severity, Verbosity verbosity, const CallSite& site);
+    Logger(Severity severity, const CallSite& site)
+        : Logger(severity, fVerbosity.load(std::memory_order_relaxed), site)
     {}
     virtual ~Logger() noexcept(false);
 
     Logger& Log() { return *this; }
 
     void LogEmptyLine();
+    // reports the given number of skipped occurrences at the end of the line (LOG_EVERY_N, LOG_EVERY_T)
+    Logger& Suppressed(uint64_t count)
+    {
+        fSuppressed = count;
+        return *this;
+    }
 
     enum class Color : int
     {
@@ -256,7 +386,7 @@ class Logger
 
     static void SetFileSeverity(const Severity severity);
     static void SetFileSeverity(const std::string& severityStr);
-    static Severity GetFileSeverity() { return fFileSeverity; }
+    static Severity GetFileSeverity() { return fFileSeverity.load(std::memory_order_relaxed); }
 
     static void SetCustomSeverity(const std::string& key, const Severity severity);
     static void SetCustomSeverity(const std::string& key, const std::string& severityStr);
@@ -269,38 +399,243 @@ class Logger
 
     static bool Logging(const Severity severity)
     {
-        return (severity >= fMinSeverity &&
-                fMinSeverity > Severity::nolog) ||
-                severity == Severity::fatal;
+        // fMinSeverity is fatal when nothing else is logged, a suppressed line costs one load and one compare
+        return severity >= fMinSeverity.load(std::memory_order_relaxed);
     }
     static bool Logging(const std::string& severityStr);
+    static bool Logging(const Severity severity, const CallSite& site)
+    {
+        CallSite::State state = site.GetState();
+        if (state == CallSite::State::severity) {
+            return Logging(severity);
+        }
+        if (state == CallSite::State::unregistered) {
+            state = site.Register();
+        }
+        return state == CallSite::State::severity ? Logging(severity) : (state == CallSite::State::enabled || severity == Severity::fatal);
+    }
+
+    // Call site registry (dynamic debug): every LOG call site is registered when it is reached for the first time.
+    // Enabled sites are written to the console and the file sink regardless of the severity thresholds, disabled sites
+    // are skipped (fatal lines are always written). A rule applies to the matching sites registered so far and to those
+    // registered later, the last matching rule wins. Globs are fnmatch patterns, the file is matched without directory.
+    // Returns the number of registered sites that matched. Sites removed at compile time (FAIR_MIN_SEVERITY) are not affected.
+    static size_t EnableCallSites(const std::string& fileGlob, const std::string& functionGlob = "*", int firstLine = 0, int lastLine = std::numeric_limits<int>::max());
+    static size_t DisableCallSites(const std::string& fileGlob, const std::string& functionGlob = "*", int firstLine = 0, int lastLine = std::numeric_limits<int>::max());
+    // drops all rules, all sites log according to the severity thresholds again
+    static void ResetCallSites();
+
+    struct CallSiteInfo
+    {
+        std::string_view file;
+        int line;
+        std::string_view function;
+        CallSite::State state;
+    };
+    // all call sites registered so far (libraries containing them must stay loaded)
+    static std::vector<CallSiteInfo> GetCallSites();
 
     static void SetVerbosity(const Verbosity verbosity);
     static void SetVerbosity(const std::string& verbosityStr);
     static Verbosity GetVerbosity();
     static void DefineVerbosity(const Verbosity, VerbositySpec);
     static void DefineVerbosity(const std::string& verbosityStr, VerbositySpec);
+    static VerbositySpec GetVerbositySpec(const Verbosity verbosity) { return fVerbosities.at(static_cast<size_t>(verbosity)); }
+
+    // renders the [...] prefix of a line for the given spec (with a trailing space if not empty),
+    // the location blocks are taken from the call site cache if given
+    static void FormatPrefix(fmt::memory_buffer& out, const VerbositySpec& spec, const LogMetaData& infos, bool colored, const CallSite* site = nullptr);
+    // renders the [file], [file:line] or [file:line:function] block
+    static void FormatLocation(fmt::memory_buffer& out, VerbositySpec::Info info, std::string_view file, std::string_view line, std::string_view func, bool colored);
 
     static void SetConsoleColor(const bool colored = true);
 
+    // when buffering sinks write out their lines
+    struct FlushPolicy
+    {
+        Severity severity = Severity::trace;    // lines of this severity and above (at least error and above) are written out right away, together with the buffered ones
+        std::chrono::milliseconds interval{ 0 }; // buffered lines are written out at the latest after this time (0: no time limit)
+        size_t bufferSize = 64 * 1024;           // and when the buffer would exceed this size
+    };
+
+    // how the console sink writes a line
+    enum class ConsoleOutput : int
+    {
+        stdio = 0, // through stdout and std::cout (default), keeps the order with other output written to them
+        direct     // the line is assembled in one buffer and written with a single write(2) to file descriptor 1,
+                   // without locking, lines up to PIPE_BUF reach a pipe in one piece
+    };
+    static void SetConsoleOutput(const ConsoleOutput output);
+    static ConsoleOutput GetConsoleOutput() { return fConsoleOutput.load(std::memory_order_relaxed); }
+    // Buffering of direct console output, applies only if stdout is a regular file (default: every line is written
+    // right away). Buffered lines are also written out by Flush(), on fatal lines and at shutdown.
+    static void SetConsoleFlushPolicy(const FlushPolicy& policy);
+
+    // clock used for LogMetaData::timestamp/us
+    enum class ClockSource : int
+    {
+        precise = 0, // std::chrono::system_clock (default)
+        coarse,      // CLOCK_REALTIME_COARSE, resolution of the kernel tick (typically 1-4 ms), falls back to precise if unavailable
+        tsc          // time stamp counter, calibrated against the realtime clock when selected, falls back to precise if unavailable
+    };
+    static void SetClockSource(const ClockSource source);
+    static ClockSource GetClockSource() { return fClockSource.load(std::memory_order_relaxed); }
+
     static std::string InitFileSink(const Severity severity, const std::string& filename, bool customizeName = true);
     static std::string InitFileSink(const std::string& severityStr, const std::string& filename, bool customizeName = true);
 
     static void RemoveFileSink();
+    // Buffering of the file sink (default: every line is written right away). Buffered lines are also written out by
+    // Flush(), on fatal lines and at shutdown.
+    static void SetFileFlushPolicy(const FlushPolicy& policy);
+
+    // Rotation of the file sink: the current file keeps its name, rotated files get a .<time>.<n> suffix.
+    // Logging threads only rename and reopen, closing and compressing happens on a background thread.
+    struct RotationPolicy
+    {
+        size_t maxBytes = 0;                // rotate before the file would exceed this size (0: no size limit)
+        std::chrono::seconds interval{ 0 }; // rotate files older than this (0: no time limit)
+        unsigned keep = 0;                  // rotated files to keep, older ones are deleted (0: keep all)
+        bool compress = true;               // gzip rotated files (only if built with zlib)
+    };
+    static void SetFileRotation(const RotationPolicy& policy);
+    // Files opened by InitFileSink() afterwards are written as a series of independent gzip members, one per write out
+    // of the flush policy (customized names end in .log.gz). Without a buffering flush policy, error and above end a
+    // member right away and other lines after at most a second or 64 KB. Returns false if built without zlib.
+    static bool SetFileCompression(bool compress);
+
+    // Binary file sink: call site metadata is written once, each line only as a compact record.
+    // Use the fairlogger-decode tool to turn the file back into text.
+    static std::string InitBinaryFileSink(const Severity severity, const std::string& filename, bool customizeName = true);
+    static std::string InitBinaryFileSink(const std::string& severityStr, const std::string& filename, bool customizeName = true);
+    static void RemoveBinaryFileSink();
+    static Severity GetBinaryFileSeverity() { return fBinaryFileSeverity.load(std::memory_order_relaxed); }
+
+    // Ring file sink: lines are copied into a memory-mapped file of the given size, overwriting the oldest ones.
+    // The lines survive a crash of the process without a system call per line. Use the fairlogger-ring tool to extract them.
+    static std::string InitRingFileSink(const Severity severity, const std::string& filename, size_t size, bool customizeName = true);
+    static std::string InitRingFileSink(const std::string& severityStr, const std::string& filename, size_t size, bool customizeName = true);
+    static void RemoveRingFileSink();
+    static Severity GetRingFileSeverity() { return fRingFileSeverity.load(std::memory_order_relaxed); }
 
     static std::string_view SeverityName(Severity s) { return fSeverityNames.at(static_cast<size_t>(s)); }
     static std::string_view VerbosityName(Verbosity v) { return fVerbosityNames.at(static_cast<size_t>(v)); }
 
     static void OnFatal(std::function<void()> func);
 
+    // Flight recorder: lines of recordSeverity and above that no console or file sink writes are kept in memory, up to
+    // capacity lines per thread. A line of triggerSeverity or above (including fatal) first writes them out, oldest first,
+    // to the active console, file, ring and binary file sinks regardless of their severities. A record severity of nolog disables it.
+    static void SetFlightRecorder(Severity recordSeverity, Severity triggerSeverity = Severity::error, size_t capacity = 1024);
+    // writes out the recorded lines now
+    static void DumpFlightRecorder();
+
+    // queues of the asynchronous mode
+    enum class AsyncQueues : int
+    {
+        shared,    // one queue for all threads (default)
+        per_thread // one single-producer queue per thread, growing up to queueCapacity records, merged in time order by the writer
+    };
+
+    // Asynchronous mode: the logging thread only hands the finished record to a lock-free queue,
+    // a background thread writes it to the console, file and custom sinks.
+    // When the queue is full, the logging thread waits for free space, no records are dropped.
+    static void StartAsync(size_t queueCapacity = 8192, AsyncQueues queues = AsyncQueues::shared);
+    // writes all queued records and stops the background thread
+    static void StopAsync();
+    static bool IsAsync() { return fAsyncWriter.load() != nullptr; }
+    // blocks until all records queued so far are written and hands pending batches to their batch sinks
+    static void Flush();
+
     static void AddCustomSink(const std::string& key, Severity severity, std::function<void(const std::string& content, const LogMetaData& metadata)> sink);
     static void AddCustomSink(const std::string& key, const std::string& severityStr, std::function<void(const std::string& content, const LogMetaData& metadata)> sink);
+    // Sink receiving a view of the content (valid only during the call) and the extended metadata, no string is built for it.
+    static void AddCustomSink(const std::string& key, Severity severity, std::function<void(std::string_view content, const ExtendedLogMetaData& metadata)> sink);
+    static void AddCustomSink(const std::string& key, const std::string& severityStr, std::function<void(std::string_view content, const ExtendedLogMetaData& metadata)> sink);
+    // picks the signature for lambdas and other callables, callables accepting (const std::string&, const LogMetaData&) keep the original one
+    template<typename F>
+    static void AddCustomSink(const std::string& key, Severity severity, F&& sink) { AddCustomSink(key, severity, ToCustomSinkFunction(std::forward<F>(sink))); }
+    template<typename F>
+    static void AddCustomSink(const std::string& key, const std::string& severityStr, F&& sink) { AddCustomSink(key, severityStr, ToCustomSinkFunction(std::forward<F>(sink))); }
+    // Sink receiving the lines in batches: a batch is handed over once it holds maxRecords lines, once its first line
+    // is older than maxDelay, on a fatal line, on Flush() and at shutdown. The records are valid only during the call.
+    static void AddCustomBatchSink(const std::string& key, Severity severity, size_t maxRecords, std::chrono::microseconds maxDelay, std::function<void(const std::vector<CustomSinkRecord>& records)> sink);
+    static void AddCustomBatchSink(const std::string& key, const std::string& severityStr, size_t maxRecords, std::chrono::microseconds maxDelay, std::function<void(const std::vector<CustomSinkRecord>& records)> sink);
     static void RemoveCustomSink(const std::string& key);
 
+    // what a sink queue does with a line when it is full
+    enum class OverflowPolicy : int
+    {
+        block,       // the logging thread waits for free space (default)
+        drop_newest, // the new line is dropped
+        drop_oldest  // the oldest queued line is dropped
+    };
+    // Gives the custom sink (or the file sink) a bounded queue and its own thread, so that a slow sink delays neither
+    // the logging threads nor the other sinks. A capacity of 0 calls the sink directly again (the default).
+    // Flush() waits for the queues as well.
+    static void SetCustomSinkQueue(const std::string& key, size_t capacity, OverflowPolicy policy = OverflowPolicy::block);
+    static void SetFileSinkQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::block);
+    // number of lines dropped by the queue of the sink so far
+    static uint64_t GetCustomSinkDrops(const std::string& key);
+    static uint64_t GetFileSinkDrops();
+
+    // Suppression of repeated lines: a line with the same severity, call site and content (compared by hash) as the
+    // previous line of the sink is held back and counted. The count is written as one "last message repeated N times"
+    // line with the metadata of the last repeat: before the next different line, once the first held back repeat is
+    // older than the timeout, on Flush() and at exit. A timeout of 0 disables the suppression (the default).
+    static void SetConsoleRepeatSuppression(std::chrono::milliseconds timeout);
+    static void SetFileRepeatSuppression(std::chrono::milliseconds timeout);
+    static void SetCustomSinkRepeatSuppression(const std::string& key, std::chrono::milliseconds timeout);
+
+    // Global budget of all sinks: token buckets of lines and bytes per second, each holding a burst worth of them.
+    // When the budget runs low, lines below shedSeverity are dropped first (once less than the reserve is left), then
+    // all lines below error. Lines of error and above always pass and use up the budget as well.
+    struct ThrottlePolicy
+    {
+        double lines = 0;                                  // lines per second (0: no line limit)
+        double bytes = 0;                                  // bytes of content per second (0: no byte limit)
+        std::chrono::milliseconds burst{ 1000 };           // size of the buckets, as time of the rates
+        Severity shedSeverity = Severity::warn;            // lines below this severity are dropped first
+        double reserve = 0.5;                              // fraction of the buckets kept for lines of shedSeverity and above
+        std::chrono::milliseconds reportInterval{ 10000 }; // the drops are reported in a warn line at most this often (0: never)
+    };
+    // a policy without line and byte limit disables the throttle (the default)
+    static void SetThrottle(const ThrottlePolicy& policy);
+    // lines of the given severity dropped by the throttle so far
+    static uint64_t GetThrottleDrops(Severity severity);
+
+    // Statistics of the logger itself, counted while enabled (off by default). The counters are kept per thread
+    // and summed up only when they are read.
+    struct Stats
+    {
+        struct Sink
+        {
+            std::string name; // console, file, ring file, binary file or the key of a custom sink
+            bool custom;
+            uint64_t writes;  // lines handed to the sink
+            uint64_t errors;  // failed writes, calls of a custom sink that threw
+        };
+        std::array<uint64_t, 16> messages{}; // lines logged, per Severity
+        std::array<uint64_t, 16> bytes{};    // bytes of their content, per Severity
+        std::vector<Sink> sinks;
+        // time spent in ~Logger() by the logging thread: logTime[i] counts the lines that took from 2^i up to
+        // 2^(i+1) ns, the last entry all longer ones as well
+        std::array<uint64_t, 32> logTime{};
+    };
+    static void SetStats(bool enabled);
+    // counted since the start or the last reset, reset: count anew from now on
+    static Stats GetStats(bool reset = false);
+
     template<typename T>
     Logger& operator<<(const T& t)
     {
-        fContent << t;
+        if constexpr (HasFastPath<T>()) {
+            if (!fStream) {
+                AppendFast(t);
+                return *this;
+            }
+        }
+        Stream() << t;
         return *this;
     }
 
@@ -308,7 +643,11 @@ class Logger
     Logger& operator<<(const char* cptr)
     {
         if (cptr != nullptr) {
-            fContent << cptr;
+            if (!fStream) {
+                fContent.append(cptr, cptr + std::strlen(cptr));
+            } else {
+                Stream() << cptr;
+            }
         }
         return *this;
     }
@@ -316,15 +655,22 @@ class Logger
     // overload for char* to make sure it is not nullptr
     Logger& operator<<(char* cptr)
     {
-        if (cptr != nullptr) {
-            fContent << cptr;
-        }
-        return *this;
+        return *this << static_cast<const char*>(cptr);
     }
 
     Logger& operator<<(std::ios_base& (*manip) (std::ios_base&));
     Logger& operator<<(std::ostream& (*manip) (std::ostream&));
 
+    // Deferred formatting (LOGPA, LOGFA): only the format string pointer and a binary copy of the arguments
+    // are stored, the formatting happens when the line is written (on the writer thread in asynchronous mode).
+    // The format string must outlive the logger (string literal), arguments must be strings or trivially copyable.
+    template<size_t N, typename ... Args>
+    Logger& DeferFormat(const char (&format)[N], const Args& ... args) { return Defer<false>(format, args ...); }
+    template<size_t N, typename ... Args>
+    Logger& DeferPrintf(const char (&format)[N], const Args& ... args) { return Defer<true>(format, args ...); }
+
+    using DeferredFormatter = void (*)(std::string_view format, const char* args, fmt::memory_buffer& out);
+
     static const std::unordered_map<std::string_view, Verbosity> fVerbosityMap;
     static const std::unordered_map<std::string_view, Severity> fSeverityMap;
     static const std::array<std::string_view, 16> fSeverityNames;
@@ -332,7 +678,7 @@ class Logger
 
     // protection for use after static destruction took place
     static bool fIsDestructed;
-    static struct DestructionHelper { ~DestructionHelper() { Logger::fIsDestructed = true; }} fDestructionHelper;
+    static struct DestructionHelper { ~DestructionHelper() { Logger::StopAsync(); Logger::StopSinkThreads(); Logger::fIsDestructed = true; }} fDestructionHelper;
 
     static bool constexpr SuppressSeverity(Severity sev)
     {
@@ -340,35 +686,318 @@ class Logger
     }
 
   private:
-    LogMetaData fInfos;
+    class AsyncWriter;
+    class BinaryFileSink;
+    class RingFileSink;
+    class CustomSinks;
+    struct CustomSink;
+    class SinkWorker;
+    class FdWriter;
+    class FlightRecorder;
+    class RepeatFilter;
+    struct RepeatTimer;
+    class Throttle;
+    class StatsCollector;
+
+    // arguments of a deferred line in their binary form
+    struct DeferredArgs
+    {
+        DeferredFormatter fFormatter;
+        std::string_view fFormat;
+        const char* fTypes; // see BinaryFormat.h
+        std::string_view fArgs;
+    };
 
-    std::ostringstream fContent;
-    fmt::memory_buffer fColorPrefix;
-    fmt::memory_buffer fBWPrefix;
-    static const std::string fProcessName;
-    static bool fColored;
-    static std::fstream fFileStream;
+    // std::ostream appending to fContent. It is only constructed (stream and locale setup) when a type without a fast path
+    // or a manipulator is streamed, from then on all output goes through it to respect the stream state (e.g. std::hex).
+    class ContentStreamBuf : public std::streambuf
+    {
+      public:
+        explicit ContentStreamBuf(fmt::memory_buffer& buf) : fBuf(buf) {}
+
+      protected:
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                fBuf.push_back(traits_type::to_char_type(c));
+            }
+            return traits_type::not_eof(c);
+        }
 
-    static Severity fConsoleSeverity;
-    static Severity fFileSeverity;
-    static Severity fMinSeverity;
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            fBuf.append(s, s + n);
+            return n;
+        }
 
-    static Verbosity fVerbosity;
+      private:
+        fmt::memory_buffer& fBuf;
+    };
+
+    struct ContentStream
+    {
+        explicit ContentStream(fmt::memory_buffer& buf) : fBuf(buf), fStream(&fBuf) {}
+        ContentStreamBuf fBuf;
+        std::ostream fStream;
+    };
+
+    ExtendedLogMetaData fInfos;
+    const CallSite* fSite;
+
+    // message content, inline storage for typical lines, spills to the heap only for long ones
+    fmt::memory_buffer fContent;
+    std::optional<ContentStream> fStream;
+    DeferredFormatter fDeferredFormatter;
+    std::string_view fDeferredFormat;
+    const char* fDeferredTypes;
+    fmt::basic_memory_buffer<char, 128> fDeferredArgs;
+    // the prefix is rendered only when the line is written, see Write()
+    Verbosity fLineVerbosity;
+    uint64_t fSuppressed; // occurrences skipped by LOG_EVERY_N/LOG_EVERY_T, reported at the end of the line
+    static const std::string fProcessName;
+    static std::atomic<bool> fColored;
+    static FdWriter fFileWriter;
+
+    static BinaryFileSink fBinaryFileSink;
+    static RingFileSink fRingFileSink;
+    static FlightRecorder fFlightRecorder;
+    static RepeatFilter fConsoleRepeats;
+    static RepeatFilter fFileRepeats;
+    static std::atomic<RepeatTimer*> fRepeatTimer;
+    static Throttle fThrottle;
+    static StatsCollector fStats;
+
+    // thresholds are read with relaxed loads while logging, changes are serialized by fSeverityMtx
+    static std::atomic<Severity> fConsoleSeverity;
+    static std::atomic<Severity> fFileSeverity;
+    static std::atomic<Severity> fBinaryFileSeverity;
+    static std::atomic<Severity> fRingFileSeverity;
+    static std::atomic<Severity> fCustomSinksSeverity; // lowest severity of all custom sinks, updated under fMtx
+    static std::atomic<Severity> fMinSeverity; // lowest severity of all sinks, fatal if no sink is active
+    static std::mutex fSeverityMtx;
+
+    static std::atomic<Verbosity> fVerbosity;
+
+    static std::atomic<uint64_t> fSequence;
+
+    static std::atomic<ClockSource> fClockSource;
+    static std::atomic<ConsoleOutput> fConsoleOutput;
+    static FdWriter fConsoleWriter;
 
     static std::function<void()> fFatalCallback;
-    static std::unordered_map<std::string, std::pair<Severity, std::function<void(const std::string& content, const LogMetaData& metadata)>>> fCustomSinks;
+    static CustomSinks fCustomSinks; // changed under fMtx, read without lock
     static std::mutex fMtx;
 
-    bool LoggingToConsole() const;
-    bool LoggingToFile() const;
-    bool LoggingCustom(const Severity) const;
+    static std::atomic<AsyncWriter*> fAsyncWriter;
+    static std::atomic<SinkWorker*> fFileWorker;
+    static std::atomic<uint64_t> fFileDrops;
+
+    static bool LoggingToConsole(const Severity severity);
+    static bool LoggingToFile(const Severity severity);
+    static bool LoggingToBinaryFile(const Severity severity);
+    static bool LoggingToRingFile(const Severity severity);
+    // true if the console or one of the file sinks writes the line
+    static bool Written(const Severity severity, const CallSite* site);
+    static bool LoggingCustom(const Severity severity, const Severity sinkSeverity);
+
+    static void InsertCustomSink(const std::string& key, Severity severity, std::shared_ptr<CustomSink> sink);
+    // stops the batch and repeat timers, drains the sink queues and hands all pending batches over
+    static void StopSinkThreads();
+    static void FlushSinkWorkers();
+    static size_t SetCallSites(const std::string& fileGlob, const std::string& functionGlob, int firstLine, int lastLine, CallSite::State state);
+
+    static std::string CustomizedFileName(const std::string& filename, const std::string& extension);
+
+    std::string Content() const;
+    bool Enqueue();
+    // replay: line from the flight recorder, written to all active console and file sinks regardless of their severities
+    static void Write(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, std::string_view content, const DeferredArgs& deferred, bool replay = false);
+    // writes out the lines recorded up to the given time
+    static void WriteFlightRecorder(std::time_t timestamp, std::chrono::microseconds us);
+    // write one line to the console or the file sink, prefix is the plain one (not used by the colored console)
+    static void WriteToConsole(const VerbositySpec& spec, const ExtendedLogMetaData& infos, const CallSite* site, bool colored, std::string_view prefix, std::string_view text);
+    static void WriteToFile(const ExtendedLogMetaData& infos, const CallSite* site, std::string_view prefix, std::string_view text);
+    // writes the summary line of held back repeats (see RepeatFilter) to the console or the file sink
+    static void WriteRepeats(bool console, const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, std::string_view summary);
+    // writes the summaries of the repeats held back by all sinks so far
+    static void WriteRepeats();
+    // writes the summaries of the repeats whose timeout has passed, returns the earliest timeout still pending
+    static std::chrono::steady_clock::time_point WriteExpiredRepeats();
+    // the repeat timer writes the summaries once their timeout has passed, also if no further line arrives
+    static void StartRepeatTimer();
+    static void StopRepeatTimer();
+    // wakes the timer to wait for the timeout of a first held back repeat
+    static void NotifyRepeatTimer();
+    // logs the lines dropped by the throttle, if they are due to be reported
+    static void ReportThrottle(int64_t now);
+    void Init(Severity severity);
 
     static void UpdateMinSeverity();
+    static void UpdateCustomSinksSeverity();
 
     void FillTimeInfos();
+    void FillExtendedInfos(Severity severity);
+
+    template<typename F>
+    static auto ToCustomSinkFunction(F&& sink)
+    {
+        if constexpr (std::is_invocable<F&, const std::string&, const LogMetaData&>::value) {
+            return std::function<void(const std::string&, const LogMetaData&)>(std::forward<F>(sink));
+        } else {
+            static_assert(std::is_invocable<F&, std::string_view, const ExtendedLogMetaData&>::value,
+                          "custom sinks must accept (const std::string&, const LogMetaData&) or (std::string_view, const ExtendedLogMetaData&)");
+            return std::function<void(std::string_view, const ExtendedLogMetaData&)>(std::forward<F>(sink));
+        }
+    }
     bool fTimeCalculated;
 
-    static std::map<Verbosity, VerbositySpec> fVerbosities;
+    // indexed by Verbosity
+    static std::array<VerbositySpec, 9> fVerbosities;
+
+    std::ostream& Stream()
+    {
+        if (!fStream) {
+            fStream.emplace(fContent);
+        }
+        return fStream->fStream;
+    }
+
+    // types that are appended without std::ostream, with output identical to it (default stream state)
+    template<typename T>
+    static constexpr bool HasFastPath()
+    {
+        return (std::is_arithmetic<T>::value && !std::is_same<T, long double>::value)
+            || std::is_same<T, std::string>::value
+            || std::is_same<T, std::string_view>::value;
+    }
+
+    template<typename T>
+    void AppendFast(const T& t)
+    {
+        if constexpr (std::is_same<T, bool>::value) {
+            fContent.push_back(t ? '1' : '0');
+        } else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value) {
+            fContent.push_back(static_cast<char>(t));
+        } else if constexpr (std::is_integral<T>::value) {
+            fmt::format_int str(t);
+            fContent.append(str.data(), str.data() + str.size());
+        } else if constexpr (std::is_floating_point<T>::value) {
+            fmt::format_to(std::back_inserter(fContent), "{:g}", t);
+        } else {
+            fContent.append(t.data(), t.data() + t.size());
+        }
+    }
+
+    template<typename T>
+    static constexpr bool IsDeferredString() { return std::is_convertible<const T&, std::string_view>::value; }
+
+    // type tag of a deferred argument, see BinaryFormat.h
+    template<typename T>
+    static constexpr char DeferredTypeTag()
+    {
+        if constexpr (IsDeferredString<T>()) {
+            return 's';
+        } else if constexpr (std::is_same<T, bool>::value) {
+            return 'b';
+        } else if constexpr (std::is_same<T, char>::value) {
+            return 'c';
+        } else if constexpr (std::is_integral<T>::value) {
+            return std::is_signed<T>::value ? 'i' : 'u';
+        } else if constexpr (std::is_same<T, float>::value) {
+            return 'f';
+        } else if constexpr (std::is_same<T, double>::value) {
+            return 'd';
+        } else if constexpr (std::is_pointer<T>::value) {
+            return 'p';
+        } else {
+            return 'x';
+        }
+    }
+
+    template<typename T>
+    static constexpr char DeferredTypeSize()
+    {
+        return IsDeferredString<T>() ? '0' : (sizeof(T) < 10 ? static_cast<char>('0' + sizeof(T)) : '?');
+    }
+
+    template<bool Printf, typename ... Args>
+    static constexpr std::array<char, 2 * sizeof ... (Args) + 2> DeferredTypes()
+    {
+        std::array<char, 2 * sizeof ... (Args) + 2> tags{};
+        const char types[] = { DeferredTypeTag<Args>() ..., '\0' };
+        const char sizes[] = { DeferredTypeSize<Args>() ..., '\0' };
+        tags[0] = Printf ? '%' : '{';
+        for (size_t i = 0; i < sizeof ... (Args); ++i) {
+            tags[1 + 2 * i] = types[i];
+            tags[2 + 2 * i] = sizes[i];
+        }
+        return tags;
+    }
+
+    template<bool Printf, typename ... Args>
+    Logger& Defer(std::string_view format, const Args& ... args)
+    {
+        static constexpr auto types = DeferredTypes<Printf, typename std::decay<Args>::type ...>();
+        fDeferredFormat = format;
+        fDeferredTypes = types.data();
+        (EncodeDeferred(args), ...);
+        fDeferredFormatter = &DecodeAndFormat<Printf, typename std::decay<Args>::type ...>;
+        return *this;
+    }
+
+    template<typename T>
+    void EncodeDeferred(const T& t)
+    {
+        if constexpr (IsDeferredString<T>()) {
+            std::string_view sv;
+            if constexpr (std::is_pointer<T>::value) {
+                if (t != nullptr) {
+                    sv = t;
+                }
+            } else {
+                sv = t;
+            }
+            size_t size = sv.size();
+            fDeferredArgs.append(reinterpret_cast<const char*>(&size), reinterpret_cast<const char*>(&size) + sizeof(size));
+            fDeferredArgs.append(sv.data(), sv.data() + size);
+        } else {
+            static_assert(std::is_trivially_copyable<T>::value, "LOGPA/LOGFA accept only strings and trivially copyable arguments");
+            fDeferredArgs.append(reinterpret_cast<const char*>(&t), reinterpret_cast<const char*>(&t) + sizeof(T));
+        }
+    }
+
+    template<typename T>
+    static auto DecodeDeferred(const char*& pos)
+    {
+        if constexpr (IsDeferredString<T>()) {
+            size_t size;
+            std::memcpy(&size, pos, sizeof(size));
+            std::string_view sv(pos + sizeof(size), size);
+            pos += sizeof(size) + size;
+            return sv;
+        } else {
+            alignas(T) char storage[sizeof(T)];
+            std::memcpy(storage, pos, sizeof(T));
+            pos += sizeof(T);
+            return *reinterpret_cast<const T*>(storage);
+        }
+    }
+
+    template<bool Printf, typename ... Args>
+    static void DecodeAndFormat(std::string_view format, const char* args, fmt::memory_buffer& out)
+    {
+        const char* pos = args;
+        // braced initialization guarantees left-to-right decoding
+        std::tuple<decltype(DecodeDeferred<Args>(pos)) ...> values{DecodeDeferred<Args>(pos) ...};
+        std::apply([&](const auto& ... vals) {
+            if constexpr (Printf) {
+                std::string str = fmt::sprintf(format, vals ...);
+                out.append(str.data(), str.data() + str.size());
+            } else {
+                fmt::format_to(std::back_inserter(out), fmt::runtime(format), vals ...);
+            }
+        }, values);
+    }
 };
 
 inline std::ostream& operator<<(std::ostream& os, const Severity& s) { return os << Logger::SeverityName(s); }
@@ -381,10 +1010,16 @@ inline std::ostream& operator<<(std::ostream& os, const Verbosity& v) { return o
 
 #ifdef FAIRLOGGER_USE_BOOST_PRETTY_FUNCTION
 #define MSG_ORIGIN __FILE__, CONVERTTOSTRING(__LINE__), static_cast<const char*>(BOOST_CURRENT_FUNCTION)
+#define MSG_SITE __FILE__, __LINE__, CONVERTTOSTRING(__LINE__), BOOST_CURRENT_FUNCTION
 #else
 #define MSG_ORIGIN __FILE__, CONVERTTOSTRING(__LINE__), static_cast<const char*>(__FUNCTION__)
+#define MSG_SITE __FILE__, __LINE__, CONVERTTOSTRING(__LINE__), __FUNCTION__
 #endif
 
+// loop of the LOG macros that declares the static call site (runs once, like the enclosing loop)
+#define FAIR_LOG_SITE_LOOP(flag) \
+    for (static fair::CallSite fairLOggerSite(MSG_SITE); !flag; flag = true)
+
 // allow user of this header file to prevent definition of the LOG macro, by defining FAIR_NO_LOG before including this header
 #ifndef FAIR_NO_LOG
 #undef LOG
@@ -405,6 +1040,16 @@ inline std::ostream& operator<<(std::ostream& os, const Verbosity& v) { return o
 #undef LOGF
 #define LOGF FAIR_LOGF
 #endif
+// allow user of this header file to prevent definition of the LOGPA macro, by defining FAIR_NO_LOGPA before including this header
+#ifndef FAIR_NO_LOGPA
+#undef LOGPA
+#define LOGPA FAIR_LOGPA
+#endif
+// allow user of this header file to prevent definition of the LOGFA macro, by defining FAIR_NO_LOGFA before including this header
+#ifndef FAIR_NO_LOGFA
+#undef LOGFA
+#define LOGFA FAIR_LOGFA
+#endif
 // allow user of this header file to prevent definition of the LOGN macro, by defining FAIR_NO_LOGN before including this header
 #ifndef FAIR_NO_LOGN
 #undef LOGN
@@ -420,6 +1065,21 @@ inline std::ostream& operator<<(std::ostream& os, const Verbosity& v) { return o
 #undef LOG_IF
 #define LOG_IF FAIR_LOG_IF
 #endif
+// allow user of this header file to prevent definition of the LOG_EVERY_N macro, by defining FAIR_NO_LOG_EVERY_N before including this header
+#ifndef FAIR_NO_LOG_EVERY_N
+#undef LOG_EVERY_N
+#define LOG_EVERY_N FAIR_LOG_EVERY_N
+#endif
+// allow user of this header file to prevent definition of the LOG_FIRST_N macro, by defining FAIR_NO_LOG_FIRST_N before including this header
+#ifndef FAIR_NO_LOG_FIRST_N
+#undef LOG_FIRST_N
+#define LOG_FIRST_N FAIR_LOG_FIRST_N
+#endif
+// allow user of this header file to prevent definition of the LOG_EVERY_T macro, by defining FAIR_NO_LOG_EVERY_T before including this header
+#ifndef FAIR_NO_LOG_EVERY_T
+#undef LOG_EVERY_T
+#define LOG_EVERY_T FAIR_LOG_EVERY_T
+#endif
 // allow user of this header file to prevent definition of the LOGPD macro, by defining FAIR_NO_LOGPD before including this header
 #ifndef FAIR_NO_LOGPD
 #undef LOGPD
@@ -434,35 +1094,44 @@ inline std::ostream& operator<<(std::ostream& os, const Verbosity& v) { return o
 // Log line if the provided severity is below or equals the configured one
 #define FAIR_LOG(severity) \
     for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(fair::Severity::severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
-        for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
-            fair::Logger(fair::Severity::severity, MSG_ORIGIN)
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity, fairLOggerSite) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
+                fair::Logger(fair::Severity::severity, fairLOggerSite)
 
 // Log line with the given verbosity if the provided severity is below or equals the configured one
 #define FAIR_LOGV(severity, verbosity) \
     for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(fair::Severity::severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
-        for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
-            fair::Logger(fair::Severity::severity, fair::Verbosity::verbosity, MSG_ORIGIN)
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity, fairLOggerSite) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
+                fair::Logger(fair::Severity::severity, fair::Verbosity::verbosity, fairLOggerSite)
 
 // Log with fmt- or printf-like formatting
 #define FAIR_LOGP(severity, ...) FAIR_LOG(severity) << fmt::format(__VA_ARGS__)
 #define FAIR_LOGF(severity, ...) FAIR_LOG(severity) << fmt::sprintf(__VA_ARGS__)
 
+// Log with fmt- or printf-like formatting, deferred until the line is written (format string must be a literal)
+#define FAIR_LOGPA(severity, ...) FAIR_LOG(severity).DeferFormat(__VA_ARGS__)
+#define FAIR_LOGFA(severity, ...) FAIR_LOG(severity).DeferPrintf(__VA_ARGS__)
+
 // Log with fmt- or printf-like formatting (dynamic severity)
 #define FAIR_LOGPD(severity, ...) \
     for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
-        for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(severity) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
-            fair::Logger(severity, MSG_ORIGIN) << fmt::format(__VA_ARGS__)
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(severity, fairLOggerSite) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
+                fair::Logger(severity, fairLOggerSite) << fmt::format(__VA_ARGS__)
 
 #define FAIR_LOGFD(severity, ...) \
     for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
-        for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(severity) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
-            fair::Logger(severity, MSG_ORIGIN) << fmt::sprintf(__VA_ARGS__)
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(severity, fairLOggerSite) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
+                fair::Logger(severity, fairLOggerSite) << fmt::sprintf(__VA_ARGS__)
 
 // Log an empty line
 #define FAIR_LOGN(severity) \
     for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(fair::Severity::severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
-        for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
-            fair::Logger(fair::Severity::severity, fair::Verbosity::verylow, MSG_ORIGIN).LogEmptyLine()
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (bool fairLOggerunLikelyvariable = false; fair::Logger::Logging(fair::Severity::severity, fairLOggerSite) && !fairLOggerunLikelyvariable; fairLOggerunLikelyvariable = true) \
+                fair::Logger(fair::Severity::severity, fair::Verbosity::verylow, fairLOggerSite).LogEmptyLine()
 
 // Log with custom file, line, function
 #define FAIR_LOGD(severity, file, line, f) \
@@ -475,4 +1144,21 @@ inline std::ostream& operator<<(std::ostream& os, const Verbosity& v) { return o
         for (bool fairLOggerunLikelyvariable2 = false; condition && !fairLOggerunLikelyvariable2; fairLOggerunLikelyvariable2 = true) \
             FAIR_LOG(severity)
 
+// Rate-limited lines: the static rate limit of the site is checked only if the severity is logged, the logger is
+// constructed only for the occurrences that pass the check.
+#define FAIR_LOG_LIMITED(severity, check) \
+    for (bool fairLOggerunLikelyvariable3 = false; !fair::Logger::SuppressSeverity(fair::Severity::severity) && !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
+        FAIR_LOG_SITE_LOOP(fairLOggerunLikelyvariable3) \
+            for (static fair::RateLimit fairLOggerLimit; !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
+                for (uint64_t fairLOggerSuppressed = 0; !fairLOggerunLikelyvariable3; fairLOggerunLikelyvariable3 = true) \
+                    for (bool fairLOggerunLikelyvariable = false; !fairLOggerunLikelyvariable && fair::Logger::Logging(fair::Severity::severity, fairLOggerSite) && (check); fairLOggerunLikelyvariable = true) \
+                        fair::Logger(fair::Severity::severity, fairLOggerSite).Suppressed(fairLOggerSuppressed)
+
+// Log the first and then every n-th occurrence, with the number of skipped ones
+#define FAIR_LOG_EVERY_N(severity, n) FAIR_LOG_LIMITED(severity, fairLOggerLimit.EveryN(n, fairLOggerSuppressed))
+// Log only the first n occurrences
+#define FAIR_LOG_FIRST_N(severity, n) FAIR_LOG_LIMITED(severity, fairLOggerLimit.FirstN(n))
+// Log at most once per interval (seconds), with the number of skipped occurrences
+#define FAIR_LOG_EVERY_T(severity, seconds) FAIR_LOG_LIMITED(severity, fairLOggerLimit.EveryT(seconds, fairLOggerSuppressed))
+
 #endif // FAIR_LOGGER_H
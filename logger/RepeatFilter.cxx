@@ -0,0 +1,124 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "RepeatFilter.h"
+
+#include <algorithm> // min
+#include <functional> // hash
+
+using namespace std;
+
+namespace fair
+{
+
+Logger::RepeatFilter::RepeatFilter()
+    : fTimeout(chrono::milliseconds(0))
+    , fHasLast(false)
+    , fLastHash(0)
+    , fLastSite(nullptr)
+    , fLastSeverity(Severity::nolog)
+    , fCount(0)
+    , fLast{ {}, nullptr, Verbosity::low }
+{}
+
+optional<Logger::RepeatFilter::Summary> Logger::RepeatFilter::Configure(chrono::milliseconds timeout)
+{
+    lock_guard<mutex> lock(fMtx);
+    fTimeout = timeout;
+    fHasLast = false;
+    if (fCount > 0) {
+        return MakeSummary();
+    }
+    return nullopt;
+}
+
+bool Logger::RepeatFilter::Hold(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, string_view content, optional<Summary>& summary)
+{
+    uint64_t hash = std::hash<string_view>()(content);
+    if (!site) {
+        hash ^= std::hash<string_view>()(infos.file) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<string_view>()(infos.line) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+
+    lock_guard<mutex> lock(fMtx);
+    if (!fHasLast || hash != fLastHash || site != fLastSite || infos.severity != fLastSeverity) {
+        if (fCount > 0) {
+            summary = MakeSummary();
+        }
+        fHasLast = true;
+        fLastHash = hash;
+        fLastSite = site;
+        fLastSeverity = infos.severity;
+        return false;
+    }
+
+    const auto now = chrono::steady_clock::now();
+    if (fCount == 0) {
+        fFirst = now;
+        NotifyRepeatTimer();
+    }
+    ++fCount;
+    // only the metadata of the last repeat is kept, see Summary::Metadata()
+    fLast.fRecord.metadata = infos;
+    fLast.fRecord.origin.clear();
+    if (!site) {
+        fLast.fRecord.origin.append(infos.file).append(infos.line).append(infos.func);
+    }
+    fLast.fSite = site;
+    fLast.fVerbosity = verbosity;
+    if (now - fFirst >= fTimeout.load(memory_order_relaxed)) {
+        summary = MakeSummary();
+    }
+    return true;
+}
+
+optional<Logger::RepeatFilter::Summary> Logger::RepeatFilter::Take()
+{
+    lock_guard<mutex> lock(fMtx);
+    if (fCount > 0) {
+        return MakeSummary();
+    }
+    return nullopt;
+}
+
+optional<Logger::RepeatFilter::Summary> Logger::RepeatFilter::TakeExpired(chrono::steady_clock::time_point now, chrono::steady_clock::time_point& next)
+{
+    lock_guard<mutex> lock(fMtx);
+    if (fCount == 0) {
+        return nullopt;
+    }
+    const auto timeout = fFirst + fTimeout.load(memory_order_relaxed);
+    if (now >= timeout) {
+        return MakeSummary();
+    }
+    next = min(next, timeout);
+    return nullopt;
+}
+
+Logger::RepeatFilter::Summary Logger::RepeatFilter::MakeSummary()
+{
+    Summary summary = fLast;
+    summary.fRecord.content = fmt::format("last message repeated {} time{}", fCount, fCount == 1 ? "" : "s");
+    fCount = 0;
+    return summary;
+}
+
+const ExtendedLogMetaData& Logger::RepeatFilter::Summary::Metadata()
+{
+    CustomSinkRecord& record = fRecord;
+    if (!record.origin.empty()) {
+        string_view origin(record.origin);
+        const size_t fileLen = record.metadata.file.size();
+        const size_t lineLen = record.metadata.line.size();
+        record.metadata.file = origin.substr(0, fileLen);
+        record.metadata.line = origin.substr(fileLen, lineLen);
+        record.metadata.func = origin.substr(fileLen + lineLen);
+    }
+    return record.metadata;
+}
+
+} // namespace fair
@@ -0,0 +1,76 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_REPEATFILTER_H
+#define FAIR_LOGGER_REPEATFILTER_H
+
+#include "Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+namespace fair
+{
+
+// Holds back the lines of one sink that repeat the previous line of the sink (same severity, same call site and same
+// content, compared by hash) and counts them. The count is handed out as a summary line once a different line
+// arrives, once the first held back repeat is older than the timeout (checked by the next line and by the repeat timer
+// of the Logger), or when it is taken (Flush(), exit).
+class Logger::RepeatFilter
+{
+  public:
+    // the held back repeats of a line
+    struct Summary
+    {
+        CustomSinkRecord fRecord; // content: the summary text, metadata: that of the last held back repeat
+        const CallSite* fSite;
+        Verbosity fVerbosity;
+
+        // the metadata, with file, line and function pointing to the own copy (the summary may have moved since)
+        const ExtendedLogMetaData& Metadata();
+    };
+
+    RepeatFilter();
+    RepeatFilter(const RepeatFilter&) = delete;
+    RepeatFilter& operator=(const RepeatFilter&) = delete;
+
+    // a timeout of 0 disables the filter, the repeats held back so far are returned
+    std::optional<Summary> Configure(std::chrono::milliseconds timeout);
+    bool Enabled() const { return fTimeout.load(std::memory_order_relaxed).count() > 0; }
+
+    // Returns true if the line is held back. Sets summary if held back repeats are to be written, before the line
+    // if it is not held back.
+    bool Hold(const ExtendedLogMetaData& infos, const CallSite* site, Verbosity verbosity, std::string_view content, std::optional<Summary>& summary);
+    // takes the repeats held back so far
+    std::optional<Summary> Take();
+    // takes the held back repeats if the timeout has passed, otherwise moves next to their timeout if that is earlier
+    std::optional<Summary> TakeExpired(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& next);
+
+  private:
+    // the caller holds fMtx
+    Summary MakeSummary();
+
+    std::atomic<std::chrono::milliseconds> fTimeout;
+    std::mutex fMtx;
+    // the previous line
+    bool fHasLast;
+    uint64_t fLastHash; // of the content, and of file and line if there is no call site
+    const CallSite* fLastSite;
+    Severity fLastSeverity;
+    // the held back repeats
+    uint64_t fCount;
+    std::chrono::steady_clock::time_point fFirst;
+    Summary fLast;
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_REPEATFILTER_H
@@ -0,0 +1,177 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "RingFileSink.h"
+#include "RingFormat.h"
+
+#include <algorithm>
+#include <atomic> // atomic_signal_fence
+#include <cstring>
+
+#include <fcntl.h> // open, posix_fallocate
+#include <sys/mman.h>
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, ftruncate
+
+using namespace std;
+
+namespace fair
+{
+
+namespace
+{
+
+// smallest file that holds the header and some lines
+constexpr size_t MinSize = 4096;
+
+bool Valid(const ringlog::Header& header, size_t size)
+{
+    return memcmp(header.magic, ringlog::Magic, sizeof(ringlog::Magic)) == 0
+        && header.version == ringlog::Version
+        && header.headerSize == ringlog::HeaderSize
+        && header.capacity == size - ringlog::HeaderSize
+        && header.tail <= header.head
+        && header.head - header.tail <= header.capacity;
+}
+
+} // namespace
+
+Logger::RingFileSink::RingFileSink()
+    : fMap(nullptr)
+    , fMapSize(0)
+    , fHeader(nullptr)
+    , fData(nullptr)
+{}
+
+Logger::RingFileSink::~RingFileSink()
+{
+    Close();
+}
+
+bool Logger::RingFileSink::Open(const string& filename, size_t size)
+{
+    Close();
+    size = max(size, MinSize);
+
+    const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    const bool resize = fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != size;
+    if (resize && ftruncate(fd, size) != 0) {
+        close(fd);
+        return false;
+    }
+    // allocates the blocks now, so that a full disk cannot turn a later write into the mapping into SIGBUS
+    posix_fallocate(fd, 0, size);
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    lock_guard<mutex> lock(fMtx);
+    fMap = static_cast<char*>(map);
+    fMapSize = size;
+    fHeader = reinterpret_cast<ringlog::Header*>(fMap);
+    fData = fMap + ringlog::HeaderSize;
+    if (resize || !Valid(*fHeader, size)) {
+        memset(fHeader, 0, ringlog::HeaderSize);
+        fHeader->version = ringlog::Version;
+        fHeader->headerSize = ringlog::HeaderSize;
+        fHeader->capacity = size - ringlog::HeaderSize;
+        memcpy(fHeader->magic, ringlog::Magic, sizeof(ringlog::Magic));
+    }
+    return true;
+}
+
+void Logger::RingFileSink::Close()
+{
+    lock_guard<mutex> lock(fMtx);
+    if (fMap) {
+        munmap(fMap, fMapSize);
+        fMap = nullptr;
+        fMapSize = 0;
+        fHeader = nullptr;
+        fData = nullptr;
+    }
+}
+
+bool Logger::RingFileSink::IsOpen()
+{
+    lock_guard<mutex> lock(fMtx);
+    return fMap != nullptr;
+}
+
+uint64_t Logger::RingFileSink::Next(uint64_t pos) const
+{
+    const uint64_t capacity = fHeader->capacity;
+    const uint64_t offset = pos % capacity;
+    if (offset + ringlog::RecordHeaderSize > capacity) {
+        return pos + capacity - offset;
+    }
+    uint32_t length;
+    memcpy(&length, fData + offset, sizeof(length));
+    if (length == ringlog::Wrap || offset + ringlog::RecordHeaderSize + length > capacity) {
+        return pos + capacity - offset;
+    }
+    return pos + ringlog::RecordHeaderSize + length;
+}
+
+void Logger::RingFileSink::Write(string_view prefix, string_view text)
+{
+    lock_guard<mutex> lock(fMtx);
+    if (!fMap) {
+        return;
+    }
+
+    const uint64_t capacity = fHeader->capacity;
+    // lines longer than the ring are cut
+    const size_t maxLength = min<uint64_t>(capacity - ringlog::RecordHeaderSize, ringlog::Wrap - 1);
+    prefix = prefix.substr(0, maxLength);
+    text = text.substr(0, maxLength - prefix.size());
+    const uint32_t length = static_cast<uint32_t>(prefix.size() + text.size());
+    const uint64_t need = ringlog::RecordHeaderSize + length;
+
+    const uint64_t head = fHeader->head;
+    const uint64_t offset = head % capacity;
+    const uint64_t pos = offset + need > capacity ? head + capacity - offset : head;
+    const uint64_t end = pos + need;
+
+    // Every step is complete in the mapping before the next one starts (the fences keep the compiler from
+    // reordering the stores), so that a reader finds consistent positions whenever the process dies.
+    uint64_t tail = fHeader->tail;
+    while (end - tail > capacity && tail < head) {
+        tail = Next(tail);
+    }
+    fHeader->tail = end - tail > capacity || tail > head ? pos : tail;
+    atomic_signal_fence(memory_order_release);
+
+    if (pos != head && offset + sizeof(ringlog::Wrap) <= capacity) {
+        memcpy(fData + offset, &ringlog::Wrap, sizeof(ringlog::Wrap));
+    }
+    char* record = fData + pos % capacity;
+    memcpy(record + ringlog::RecordHeaderSize, prefix.data(), prefix.size());
+    memcpy(record + ringlog::RecordHeaderSize + prefix.size(), text.data(), text.size());
+    const uint32_t checksum = ringlog::Crc32(text.data(), text.size(), ringlog::Crc32(prefix.data(), prefix.size()));
+    memcpy(record, &length, sizeof(length));
+    memcpy(record + sizeof(length), &checksum, sizeof(checksum));
+    atomic_signal_fence(memory_order_release);
+
+    fHeader->head = end;
+}
+
+void Logger::RingFileSink::Flush()
+{
+    lock_guard<mutex> lock(fMtx);
+    if (fMap) {
+        msync(fMap, fMapSize, MS_ASYNC);
+    }
+}
+
+} // namespace fair
@@ -0,0 +1,59 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_RINGFILESINK_H
+#define FAIR_LOGGER_RINGFILESINK_H
+
+#include "Logger.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace fair
+{
+
+namespace ringlog
+{
+struct Header;
+}
+
+// Writes lines into a fixed-size memory-mapped file organized as a ring, in the format described in RingFormat.h.
+// Lines are copied into the shared mapping, which the kernel keeps when the process dies, no system call is made per line.
+class Logger::RingFileSink
+{
+  public:
+    RingFileSink();
+    RingFileSink(const RingFileSink&) = delete;
+    RingFileSink& operator=(const RingFileSink&) = delete;
+    ~RingFileSink();
+
+    // continues the ring in an existing file of the same size, otherwise starts a new one
+    bool Open(const std::string& filename, size_t size);
+    void Close();
+    bool IsOpen();
+
+    // writes prefix and text as one record, thread-safe
+    void Write(std::string_view prefix, std::string_view text);
+    // schedules writing the mapping back to disk, only needed to survive a crash of the machine
+    void Flush();
+
+  private:
+    // position of the record after the one at pos, the caller holds fMtx
+    uint64_t Next(uint64_t pos) const;
+
+    std::mutex fMtx;
+    char* fMap;
+    size_t fMapSize;
+    ringlog::Header* fHeader;
+    char* fData;
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_RINGFILESINK_H
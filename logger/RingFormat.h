@@ -0,0 +1,73 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_RINGFORMAT_H
+#define FAIR_LOGGER_RINGFORMAT_H
+
+// Ring file layout, as written by Logger::InitRingFileSink() and read by fairlogger-ring:
+//
+// header (HeaderSize bytes, of which sizeof(Header) are used), followed by the data area of Header::capacity bytes.
+// Positions are logical byte counts since the file was created: the offset in the data area is position % capacity,
+// the number of wraps is position / capacity. Records live between tail (oldest) and head (next write):
+//   record:  u32 length, u32 checksum (Crc32 of the text), text (one line without the newline)
+// A record never crosses the end of the data area. If the next record does not fit, the rest of the area is skipped,
+// marked with a Wrap length if there is room for it, and the record starts at offset 0.
+//
+// The writer moves tail past the records it is about to overwrite before writing, and advances head after the record
+// is complete, so a process dying at any point leaves at most the record being written incomplete (bad checksum).
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fair
+{
+namespace ringlog
+{
+
+constexpr char Magic[8] = {'F', 'L', 'O', 'G', 'R', 'N', 'G', '\0'};
+constexpr uint32_t Version = 1;
+constexpr size_t HeaderSize = 64;
+constexpr size_t RecordHeaderSize = 8;
+constexpr uint32_t Wrap = 0xffffffff;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t capacity; // size of the data area
+    uint64_t head;     // position of the next record
+    uint64_t tail;     // position of the oldest record
+};
+static_assert(sizeof(Header) <= HeaderSize, "ring header does not fit");
+
+// CRC-32 (IEEE 802.3)
+inline uint32_t Crc32(const char* data, size_t size, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace ringlog
+} // namespace fair
+
+#endif // FAIR_LOGGER_RINGFORMAT_H
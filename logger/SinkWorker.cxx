@@ -0,0 +1,127 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "SinkWorker.h"
+
+#include <cstdio> // fprintf
+#include <exception>
+
+using namespace std;
+
+namespace fair
+{
+
+Logger::SinkWorker::SinkWorker(size_t capacity, OverflowPolicy policy, atomic<uint64_t>& drops, Handler handler)
+    : fCapacity(capacity > 0 ? capacity : 1)
+    , fPolicy(policy)
+    , fHandler(std::move(handler))
+    , fPushed(0)
+    , fHandled(0)
+    , fFlushWaiters(0)
+    , fStop(false)
+    , fDrops(drops)
+    , fThreadId()
+{
+    fThread = thread(&SinkWorker::Run, this);
+}
+
+Logger::SinkWorker::~SinkWorker()
+{
+    {
+        lock_guard<mutex> lock(fMtx);
+        fStop = true;
+    }
+    fNotEmpty.notify_one();
+    fThread.join();
+}
+
+void Logger::SinkWorker::Push(const ExtendedLogMetaData& infos, const CallSite* site, string_view content)
+{
+    Item item;
+    item.fRecord.content.assign(content.data(), content.size());
+    item.fRecord.metadata = infos;
+    item.fSite = site;
+    if (!site) {
+        // the views are rebound to the copy on the worker thread, the item still moves until then
+        item.fRecord.origin.reserve(infos.file.size() + infos.line.size() + infos.func.size());
+        item.fRecord.origin.append(infos.file).append(infos.line).append(infos.func);
+    }
+
+    unique_lock<mutex> lock(fMtx);
+    if (fQueue.size() >= fCapacity) {
+        // a sink logging to itself must not wait for its own thread
+        const bool onWorker = this_thread::get_id() == fThreadId.load(memory_order_relaxed);
+        if (fPolicy == OverflowPolicy::drop_oldest) {
+            fQueue.pop_front();
+            ++fHandled;
+            fDrops.fetch_add(1, memory_order_relaxed);
+            if (fFlushWaiters > 0) {
+                fDrained.notify_all();
+            }
+        } else if (fPolicy == OverflowPolicy::drop_newest || onWorker) {
+            fDrops.fetch_add(1, memory_order_relaxed);
+            return;
+        } else {
+            fNotFull.wait(lock, [&]() { return fQueue.size() < fCapacity; });
+        }
+    }
+    fQueue.push_back(std::move(item));
+    ++fPushed;
+    lock.unlock();
+    fNotEmpty.notify_one();
+}
+
+void Logger::SinkWorker::Flush()
+{
+    if (this_thread::get_id() == fThreadId.load(memory_order_relaxed)) {
+        return;
+    }
+    unique_lock<mutex> lock(fMtx);
+    const uint64_t target = fPushed;
+    ++fFlushWaiters;
+    fDrained.wait(lock, [&]() { return fHandled >= target; });
+    --fFlushWaiters;
+}
+
+void Logger::SinkWorker::Run()
+{
+    fThreadId.store(this_thread::get_id(), memory_order_relaxed);
+    unique_lock<mutex> lock(fMtx);
+    while (true) {
+        fNotEmpty.wait(lock, [&]() { return fStop || !fQueue.empty(); });
+        if (fQueue.empty()) {
+            break; // stopped and drained
+        }
+        Item item = std::move(fQueue.front());
+        fQueue.pop_front();
+        lock.unlock();
+        fNotFull.notify_one();
+
+        CustomSinkRecord& record = item.fRecord;
+        if (!record.origin.empty()) {
+            string_view origin(record.origin);
+            const size_t fileLen = record.metadata.file.size();
+            const size_t lineLen = record.metadata.line.size();
+            record.metadata.file = origin.substr(0, fileLen);
+            record.metadata.line = origin.substr(fileLen, lineLen);
+            record.metadata.func = origin.substr(fileLen + lineLen);
+        }
+        try {
+            fHandler(record, item.fSite);
+        } catch (const exception& e) {
+            fprintf(stderr, "Logger: exception in sink worker: %s\n", e.what());
+        }
+
+        lock.lock();
+        ++fHandled;
+        if (fFlushWaiters > 0) {
+            fDrained.notify_all();
+        }
+    }
+}
+
+} // namespace fair
@@ -0,0 +1,73 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_SINKWORKER_H
+#define FAIR_LOGGER_SINKWORKER_H
+
+#include "Logger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace fair
+{
+
+// Bounded queue with its own thread in front of a single sink, so that a slow sink only delays itself.
+class Logger::SinkWorker
+{
+  public:
+    // called on the worker thread, one record at a time
+    using Handler = std::function<void(const CustomSinkRecord& record, const CallSite* site)>;
+
+    // drops are counted in the given counter, which has to outlive the worker
+    SinkWorker(size_t capacity, OverflowPolicy policy, std::atomic<uint64_t>& drops, Handler handler);
+    SinkWorker(const SinkWorker&) = delete;
+    SinkWorker& operator=(const SinkWorker&) = delete;
+    // writes everything still queued and joins the thread
+    ~SinkWorker();
+
+    // Copies the line into the queue. File, line and function are copied as well if there is no call site.
+    void Push(const ExtendedLogMetaData& infos, const CallSite* site, std::string_view content);
+    // blocks until everything queued so far is handed to the sink
+    void Flush();
+
+  private:
+    struct Item
+    {
+        CustomSinkRecord fRecord;
+        const CallSite* fSite;
+    };
+
+    void Run();
+
+    const size_t fCapacity;
+    const OverflowPolicy fPolicy;
+    Handler fHandler;
+
+    std::deque<Item> fQueue;
+    uint64_t fPushed;  // items that entered the queue
+    uint64_t fHandled; // items taken off the queue and handed over (or dropped by drop_oldest)
+    int fFlushWaiters;
+    bool fStop;
+    std::atomic<uint64_t>& fDrops;
+    std::mutex fMtx;
+    std::condition_variable fNotEmpty;
+    std::condition_variable fNotFull;
+    std::condition_variable fDrained;
+    std::thread fThread;
+    std::atomic<std::thread::id> fThreadId; // of fThread, set by the thread itself
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_SINKWORKER_H
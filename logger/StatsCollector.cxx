@@ -0,0 +1,163 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "StatsCollector.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+namespace fair
+{
+
+struct Logger::StatsCollector::Registration
+{
+    explicit Registration(StatsCollector& collector)
+        : fCollector(collector)
+        , fCounters(make_unique<Counters>())
+    {
+        lock_guard<mutex> lock(fCollector.fMtx);
+        fCollector.fThreads.push_back(fCounters.get());
+    }
+
+    ~Registration()
+    {
+        if (!Logger::fIsDestructed) {
+            fCollector.Unregister(fCounters.get());
+        }
+    }
+
+    StatsCollector& fCollector;
+    unique_ptr<Counters> fCounters;
+};
+
+size_t Logger::StatsCollector::Bucket(uint64_t ns)
+{
+    const size_t bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+    return min(bucket, HistogramSize - 1);
+}
+
+Logger::StatsCollector::Line::Line(StatsCollector& collector, Severity severity, size_t bytes)
+    : fCounters(nullptr)
+{
+    if (collector.Enabled()) {
+        fCounters = &collector.Local();
+        Add(fCounters->fMessages[static_cast<size_t>(severity)]);
+        Add(fCounters->fBytes[static_cast<size_t>(severity)], bytes);
+        fStart = chrono::steady_clock::now();
+    }
+}
+
+Logger::StatsCollector::Line::~Line()
+{
+    if (fCounters) {
+        const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - fStart).count();
+        Add(fCounters->fLogTime[Bucket(static_cast<uint64_t>(max<int64_t>(ns, 0)))]);
+    }
+}
+
+void Logger::StatsCollector::Totals::Add(const Counters& counters)
+{
+    for (size_t i = 0; i < fMessages.size(); ++i) {
+        fMessages[i] += counters.fMessages[i].load(memory_order_relaxed);
+        fBytes[i] += counters.fBytes[i].load(memory_order_relaxed);
+    }
+    for (size_t i = 0; i < fWrites.size(); ++i) {
+        fWrites[i] += counters.fWrites[i].load(memory_order_relaxed);
+    }
+    for (size_t i = 0; i < fLogTime.size(); ++i) {
+        fLogTime[i] += counters.fLogTime[i].load(memory_order_relaxed);
+    }
+    for (size_t i = 0; i < fCustomWrites.size(); ++i) {
+        fCustomWrites[i] += counters.fCustomWrites[i].load(memory_order_relaxed);
+        fCustomErrors[i] += counters.fCustomErrors[i].load(memory_order_relaxed);
+    }
+}
+
+Logger::StatsCollector::StatsCollector()
+    : fEnabled(false)
+{}
+
+Logger::StatsCollector::~StatsCollector() = default;
+
+Logger::StatsCollector::Counters& Logger::StatsCollector::Local()
+{
+    thread_local Registration registration(*this);
+    return *registration.fCounters;
+}
+
+void Logger::StatsCollector::Unregister(Counters* counters)
+{
+    lock_guard<mutex> lock(fMtx);
+    fThreads.erase(remove(fThreads.begin(), fThreads.end(), counters), fThreads.end());
+    fFinished.Add(*counters);
+}
+
+size_t Logger::StatsCollector::AcquireSlot()
+{
+    lock_guard<mutex> lock(fMtx);
+    auto free = find(fSlotUsed.begin(), fSlotUsed.end(), false);
+    if (free == fSlotUsed.end()) {
+        return NoSlot;
+    }
+    *free = true;
+    const size_t slot = free - fSlotUsed.begin();
+    // the counts of a previous sink in this slot are not reported for the new one
+    const Totals totals = Sum();
+    fBaseline.fCustomWrites[slot] = totals.fCustomWrites[slot];
+    fBaseline.fCustomErrors[slot] = totals.fCustomErrors[slot];
+    return slot;
+}
+
+void Logger::StatsCollector::ReleaseSlot(size_t slot)
+{
+    if (slot != NoSlot) {
+        lock_guard<mutex> lock(fMtx);
+        fSlotUsed[slot] = false;
+    }
+}
+
+Logger::StatsCollector::Totals Logger::StatsCollector::Sum() const
+{
+    Totals totals = fFinished;
+    for (const Counters* counters : fThreads) {
+        totals.Add(*counters);
+    }
+    return totals;
+}
+
+void Logger::StatsCollector::Collect(Stats& stats, bool reset, const vector<CustomSinkSlot>& customSinks)
+{
+    lock_guard<mutex> lock(fMtx);
+    const Totals totals = Sum();
+
+    auto since = [](const auto& total, const auto& baseline, auto& out) {
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = total[i] - baseline[i];
+        }
+    };
+    since(totals.fMessages, fBaseline.fMessages, stats.messages);
+    since(totals.fBytes, fBaseline.fBytes, stats.bytes);
+    since(totals.fLogTime, fBaseline.fLogTime, stats.logTime);
+    for (size_t i = 0; i < numSinks; ++i) {
+        stats.sinks.at(i).writes = totals.fWrites[i] - fBaseline.fWrites[i];
+    }
+    for (const auto& sink : customSinks) {
+        if (sink.fSlot == NoSlot) {
+            stats.sinks.push_back({ sink.fKey, true, 0, 0 });
+        } else {
+            stats.sinks.push_back({ sink.fKey, true, totals.fCustomWrites[sink.fSlot] - fBaseline.fCustomWrites[sink.fSlot], totals.fCustomErrors[sink.fSlot] - fBaseline.fCustomErrors[sink.fSlot] });
+        }
+    }
+
+    if (reset) {
+        fBaseline = totals;
+    }
+}
+
+} // namespace fair
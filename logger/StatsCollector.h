@@ -0,0 +1,148 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_STATSCOLLECTOR_H
+#define FAIR_LOGGER_STATSCOLLECTOR_H
+
+#include "Logger.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fair
+{
+
+// Counters for Logger::GetStats(). Every thread has its own set, written only by that thread with plain relaxed loads
+// and stores (no read-modify-write, no shared cache line), and the sets are summed up on read. The counters of
+// finished threads are added to a common total. A reset only moves the baseline that is subtracted on read.
+class Logger::StatsCollector
+{
+  public:
+    // sinks that are not custom sinks
+    enum Sink : size_t
+    {
+        console = 0,
+        file,
+        ringFile,
+        binaryFile,
+        numSinks
+    };
+    static constexpr size_t HistogramSize = 32;
+    // custom sinks get one of these slots for their counters, further ones are not counted
+    static constexpr size_t MaxCustomSinks = 64;
+    static constexpr size_t NoSlot = MaxCustomSinks;
+
+    struct Counters
+    {
+        std::array<std::atomic<uint64_t>, 16> fMessages{};
+        std::array<std::atomic<uint64_t>, 16> fBytes{};
+        std::array<std::atomic<uint64_t>, numSinks> fWrites{};
+        std::array<std::atomic<uint64_t>, HistogramSize> fLogTime{};
+        std::array<std::atomic<uint64_t>, MaxCustomSinks> fCustomWrites{};
+        std::array<std::atomic<uint64_t>, MaxCustomSinks> fCustomErrors{};
+    };
+
+    // a custom sink to be reported by Collect()
+    struct CustomSinkSlot
+    {
+        std::string fKey;
+        size_t fSlot;
+    };
+
+    // counts the line and the time until it goes out of scope, if enabled
+    class Line
+    {
+      public:
+        Line(StatsCollector& collector, Severity severity, size_t bytes);
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+        ~Line();
+
+      private:
+        Counters* fCounters;
+        std::chrono::steady_clock::time_point fStart;
+    };
+
+    StatsCollector();
+    StatsCollector(const StatsCollector&) = delete;
+    StatsCollector& operator=(const StatsCollector&) = delete;
+    ~StatsCollector();
+
+    void Enable(bool enabled) { fEnabled.store(enabled, std::memory_order_relaxed); }
+    bool Enabled() const { return fEnabled.load(std::memory_order_relaxed); }
+
+    // counters of the calling thread
+    Counters& Local();
+    // for counters of the calling thread only
+    static void Add(std::atomic<uint64_t>& counter, uint64_t n = 1) { counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void Written(Sink sink)
+    {
+        if (Enabled()) {
+            Add(Local().fWrites[sink]);
+        }
+    }
+
+    // slot for the counters of a new custom sink, NoSlot if all are taken
+    size_t AcquireSlot();
+    void ReleaseSlot(size_t slot);
+    void CustomWritten(size_t slot)
+    {
+        if (Enabled() && slot != NoSlot) {
+            Add(Local().fCustomWrites[slot]);
+        }
+    }
+    void CustomFailed(size_t slot)
+    {
+        if (Enabled() && slot != NoSlot) {
+            Add(Local().fCustomErrors[slot]);
+        }
+    }
+
+    // Fills messages, bytes, the writes of the sinks (in the order of Sink), the histogram and appends the given custom
+    // sinks, all counted since the last reset.
+    void Collect(Stats& stats, bool reset, const std::vector<CustomSinkSlot>& customSinks);
+
+  private:
+    // plain copy of the counters
+    struct Totals
+    {
+        std::array<uint64_t, 16> fMessages{};
+        std::array<uint64_t, 16> fBytes{};
+        std::array<uint64_t, numSinks> fWrites{};
+        std::array<uint64_t, HistogramSize> fLogTime{};
+        std::array<uint64_t, MaxCustomSinks> fCustomWrites{};
+        std::array<uint64_t, MaxCustomSinks> fCustomErrors{};
+
+        void Add(const Counters& counters);
+    };
+    // owned by the thread_local registration of each thread, listed in fThreads while the thread runs
+    struct Registration;
+
+    // histogram bucket of the duration: bucket i holds durations from 2^i to 2^(i+1) ns
+    static size_t Bucket(uint64_t ns);
+    // the caller holds fMtx
+    Totals Sum() const;
+
+    void Unregister(Counters* counters);
+
+    std::atomic<bool> fEnabled;
+    std::mutex fMtx;
+    std::vector<Counters*> fThreads;
+    Totals fFinished; // of finished threads
+    Totals fBaseline; // subtracted on read
+    std::array<bool, MaxCustomSinks> fSlotUsed{};
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_STATSCOLLECTOR_H
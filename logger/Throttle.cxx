@@ -0,0 +1,124 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#include "Throttle.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace fair
+{
+
+thread_local bool Logger::Throttle::fReporting = false;
+
+void Logger::Throttle::Bucket::Configure(double rate, int64_t size)
+{
+    fCost.store(rate > 0 ? 1e9 / rate : 0, memory_order_relaxed);
+    fSize.store(size, memory_order_relaxed);
+    fFull.store(0, memory_order_relaxed);
+}
+
+bool Logger::Throttle::Bucket::Take(size_t units, int64_t now, const int64_t* limit)
+{
+    const double cost = fCost.load(memory_order_relaxed);
+    if (cost == 0) {
+        return true;
+    }
+    const int64_t size = fSize.load(memory_order_relaxed);
+    const int64_t amount = static_cast<int64_t>(units * cost);
+    int64_t full = fFull.load(memory_order_relaxed);
+    while (true) {
+        int64_t next = max(full, now) + amount;
+        if (!limit) {
+            next = min(next, now + size);
+        } else if (full > now && next - now > *limit) {
+            // a line larger than the whole bucket passes only if the bucket is full
+            return false;
+        }
+        if (fFull.compare_exchange_weak(full, next, memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void Logger::Throttle::Bucket::Refund(size_t units)
+{
+    const double cost = fCost.load(memory_order_relaxed);
+    if (cost != 0) {
+        fFull.fetch_sub(static_cast<int64_t>(units * cost), memory_order_relaxed);
+    }
+}
+
+Logger::Throttle::Throttle()
+    : fEnabled(false)
+    , fShedSeverity(Severity::warn)
+    , fReserve(0.5)
+    , fReportInterval(0)
+    , fNextReport(0)
+    , fDrops()
+    , fReported()
+{}
+
+void Logger::Throttle::Configure(const ThrottlePolicy& policy)
+{
+    const int64_t burst = chrono::duration_cast<chrono::nanoseconds>(policy.burst).count();
+    fShedSeverity.store(policy.shedSeverity, memory_order_relaxed);
+    fReserve.store(clamp(policy.reserve, 0.0, 1.0), memory_order_relaxed);
+    fLines.Configure(policy.lines, burst);
+    fBytes.Configure(policy.bytes, burst);
+    fReportInterval.store(chrono::duration_cast<chrono::nanoseconds>(policy.reportInterval).count(), memory_order_relaxed);
+    fNextReport.store(0, memory_order_relaxed);
+    // the next report starts with the lines dropped under this policy
+    for (size_t i = 0; i < fDrops.size(); ++i) {
+        fReported[i].store(fDrops[i].load(memory_order_relaxed), memory_order_relaxed);
+    }
+    fEnabled.store(policy.lines > 0 || policy.bytes > 0, memory_order_relaxed);
+}
+
+bool Logger::Throttle::Admit(Severity severity, size_t bytes, int64_t now)
+{
+    if (severity >= Severity::error) {
+        fLines.Take(1, now, nullptr);
+        fBytes.Take(bytes, now, nullptr);
+        return true;
+    }
+
+    // lines below the shed severity may only use the part of the buckets above the reserve
+    const double share = severity < fShedSeverity.load(memory_order_relaxed) ? 1 - fReserve.load(memory_order_relaxed) : 1;
+    const int64_t lineLimit = static_cast<int64_t>(fLines.Size() * share);
+    const int64_t byteLimit = static_cast<int64_t>(fBytes.Size() * share);
+    if (fLines.Take(1, now, &lineLimit)) {
+        if (fBytes.Take(bytes, now, &byteLimit)) {
+            return true;
+        }
+        // a dropped line uses up none of the budget
+        fLines.Refund(1);
+    }
+    fDrops.at(static_cast<size_t>(severity)).fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+bool Logger::Throttle::Report(int64_t now, array<uint64_t, 16>& drops)
+{
+    const int64_t interval = fReportInterval.load(memory_order_relaxed);
+    int64_t next = fNextReport.load(memory_order_relaxed);
+    if (interval == 0 || now < next || !fNextReport.compare_exchange_strong(next, now + interval, memory_order_relaxed)) {
+        return false;
+    }
+
+    bool dropped = false;
+    for (size_t i = 0; i < fDrops.size(); ++i) {
+        const uint64_t total = fDrops[i].load(memory_order_relaxed);
+        drops[i] = total - fReported[i].exchange(total, memory_order_relaxed);
+        dropped = dropped || drops[i] > 0;
+    }
+    return dropped;
+}
+
+} // namespace fair
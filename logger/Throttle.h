@@ -0,0 +1,79 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+#ifndef FAIR_LOGGER_THROTTLE_H
+#define FAIR_LOGGER_THROTTLE_H
+
+#include "Logger.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace fair
+{
+
+// Global budget of lines and bytes per second. Each budget is a token bucket in its GCRA form: a single atomic time
+// (steady clock, ns) at which the bucket would be full again, which every admitted line moves forward by its cost.
+// A check costs one load and one compare-exchange per bucket, without any lock.
+class Logger::Throttle
+{
+  public:
+    Throttle();
+    Throttle(const Throttle&) = delete;
+    Throttle& operator=(const Throttle&) = delete;
+
+    void Configure(const ThrottlePolicy& policy);
+    bool Enabled() const { return fEnabled.load(std::memory_order_relaxed); }
+
+    // true if the line may be written, otherwise it is counted as dropped, now: steady clock in ns
+    bool Admit(Severity severity, size_t bytes, int64_t now);
+    // true once per report interval if lines were dropped since the last report, drops is set to their number per Severity
+    bool Report(int64_t now, std::array<uint64_t, 16>& drops);
+    // lines dropped so far
+    uint64_t Drops(Severity severity) const { return fDrops.at(static_cast<size_t>(severity)).load(std::memory_order_relaxed); }
+
+    // set while the drop report is logged, the report itself is not throttled
+    static thread_local bool fReporting;
+
+  private:
+    class Bucket
+    {
+      public:
+        Bucket() : fFull(0), fCost(0), fSize(0) {}
+
+        // rate: units per second (0: unlimited), size: the burst, in ns of the rate
+        void Configure(double rate, int64_t size);
+        // Takes the cost of the given units if the bucket holds more than what the limit (in ns) leaves free.
+        // Without a limit the cost is always taken, the debt is capped at the bucket size.
+        bool Take(size_t units, int64_t now, const int64_t* limit);
+        // gives back the cost of units taken before
+        void Refund(size_t units);
+        int64_t Size() const { return fSize.load(std::memory_order_relaxed); }
+
+      private:
+        alignas(64) std::atomic<int64_t> fFull; // time at which the bucket is full again
+        std::atomic<double> fCost;              // ns per unit
+        std::atomic<int64_t> fSize;
+    };
+
+    std::atomic<bool> fEnabled;
+    std::atomic<Severity> fShedSeverity;
+    std::atomic<double> fReserve;
+    Bucket fLines;
+    Bucket fBytes;
+
+    std::atomic<int64_t> fReportInterval; // ns, 0: no reports
+    std::atomic<int64_t> fNextReport;
+    std::array<std::atomic<uint64_t>, 16> fDrops;
+    std::array<std::atomic<uint64_t>, 16> fReported; // part of fDrops reported already
+};
+
+} // namespace fair
+
+#endif // FAIR_LOGGER_THROTTLE_H
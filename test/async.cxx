@@ -0,0 +1,191 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#include "Common.h"
+#include <Logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio> // sscanf
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace fair;
+using namespace fair::logger::test;
+
+string ReadFile(const string& name)
+{
+    ifstream t(name);
+    stringstream buffer;
+    buffer << t.rdbuf();
+    return buffer.str();
+}
+
+int main()
+{
+    try {
+        Logger::SetConsoleColor(false);
+        Logger::SetConsoleSeverity(Severity::nolog);
+        Logger::SetVerbosity(Verbosity::low);
+
+        Logger::StartAsync(16); // small queue to exercise the full-queue path
+        if (!Logger::IsAsync()) {
+            throw runtime_error("expected the logger to be in asynchronous mode after StartAsync()");
+        }
+
+        cout << "##### console output is complete after Flush()" << endl;
+        CheckOutput("^(\\[FATAL\\] line\n){100}$", []() {
+            for (int i = 0; i < 100; ++i) {
+                LOGV(fatal, low) << "line";
+            }
+            Logger::Flush();
+        });
+
+        cout << "##### deferred arguments are formatted by the writer" << endl;
+        CheckOutput("^\\[FATAL\\] deferred 0 0.5 abc\n\\[FATAL\\] deferred 1 1.5 abc\n$", []() {
+            for (int i = 0; i < 2; ++i) {
+                string temporary("abc"); // gone before the writer formats the line
+                LOGPA(fatal, "deferred {} {} {}", i, i + 0.5, temporary);
+            }
+            Logger::Flush();
+        });
+
+        cout << "##### all lines from multiple threads reach the file sink" << endl;
+        random_device rd;
+        mt19937 gen(rd());
+        uniform_int_distribution<> distrib(1, 65536);
+        string name = Logger::InitFileSink(Severity::info, string("test_async_log_" + to_string(distrib(gen))), true);
+
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t]() {
+                for (int i = 0; i < 250; ++i) {
+                    LOG(info) << "thread " << t << " line " << i;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        Logger::RemoveFileSink(); // drains the queue before closing the file
+
+        string fileContent = ReadFile(name);
+        remove(name.c_str());
+        size_t lines = count(fileContent.begin(), fileContent.end(), '\n');
+        if (lines != 1000) {
+            throw runtime_error(ToStr("expected 1000 lines in the file sink, found ", lines));
+        }
+
+        cout << "##### fatal line is written before the fatal callback runs" << endl;
+        string fatalName = Logger::InitFileSink(Severity::info, string("test_async_fatal_" + to_string(distrib(gen))), true);
+        atomic<bool> complete(false);
+        Logger::OnFatal([&]() {
+            complete = ReadFile(fatalName) == "[INFO] before\n[FATAL] fatal\n";
+        });
+        CheckOutput("^\\[FATAL\\] fatal\n$", []() {
+            LOG(info) << "before";
+            LOG(fatal) << "fatal";
+        });
+        Logger::OnFatal(nullptr);
+        Logger::RemoveFileSink();
+        remove(fatalName.c_str());
+        if (!complete) {
+            throw runtime_error("file sink was not complete when the fatal callback was called");
+        }
+
+        cout << "##### stopping writes the remaining records" << endl;
+        CheckOutput("^(\\[FATAL\\] line\n){50}$", []() {
+            for (int i = 0; i < 50; ++i) {
+                LOGV(fatal, low) << "line";
+            }
+            Logger::StopAsync();
+        });
+        if (Logger::IsAsync()) {
+            throw runtime_error("expected the logger to be in synchronous mode after StopAsync()");
+        }
+
+        cout << "##### per-thread queues are merged in time order" << endl;
+        Logger::StartAsync(16, Logger::AsyncQueues::per_thread);
+        string mergedName = Logger::InitFileSink(Severity::info, string("test_async_merged_" + to_string(distrib(gen))), true);
+        // every line is queued before the next thread starts
+        for (int i = 0; i < 20; ++i) {
+            thread([i]() { LOG(info) << "turn " << i; }).join();
+        }
+        threads.clear();
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t]() {
+                for (int i = 0; i < 250; ++i) {
+                    LOG(info) << "thread " << t << " line " << i;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        Logger::RemoveFileSink();
+
+        istringstream merged(ReadFile(mergedName));
+        remove(mergedName.c_str());
+        vector<int> next(4, 0);
+        int turn = 0;
+        for (string line; getline(merged, line);) {
+            int t = 0;
+            int i = 0;
+            if (sscanf(line.c_str(), "[INFO] thread %d line %d", &t, &i) == 2) {
+                if (t < 0 || t > 3 || i != next[t]++) {
+                    throw runtime_error(ToStr("lines of a thread are out of order at '", line, "'"));
+                }
+            } else if (line != ToStr("[INFO] turn ", turn++)) {
+                throw runtime_error(ToStr("lines of consecutive threads are out of order at '", line, "'"));
+            }
+        }
+        if (turn != 20 || next != vector<int>(4, 250)) {
+            throw runtime_error("expected all lines of the per-thread queues in the file sink");
+        }
+        Logger::StopAsync();
+
+        cout << "##### per-thread queues grow while the writer is busy" << endl;
+        Logger::StartAsync(4096, Logger::AsyncQueues::per_thread);
+        {
+            atomic<bool> release(false);
+            vector<string> received;
+            // holds up the writer until all lines are queued
+            Logger::AddCustomSink("slow", Severity::info, [&](const string& content, const LogMetaData&) {
+                while (!release.load()) {
+                    this_thread::yield();
+                }
+                received.push_back(content);
+            });
+            for (int i = 0; i < 1000; ++i) {
+                LOG(info) << i;
+            }
+            release = true;
+            Logger::Flush();
+            Logger::RemoveCustomSink("slow");
+            for (int i = 0; i < 1000; ++i) {
+                if (received.size() != 1000 || received[i] != to_string(i)) {
+                    throw runtime_error(ToStr("unexpected lines of a grown per-thread queue, ", received.size(), " received"));
+                }
+            }
+        }
+        Logger::StopAsync();
+
+        CheckOutput("^\\[FATAL\\] sync\n$", []() { LOG(fatal) << "sync"; });
+    } catch (runtime_error& rte) {
+        cout << rte.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
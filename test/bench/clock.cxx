@@ -0,0 +1,40 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+// Cost of a log line that only reaches a custom sink (which needs the timestamp), per clock source
+
+#include <Logger.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace fair;
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    Logger::SetConsoleSeverity(Severity::nolog);
+    Logger::AddCustomSink("bench", Severity::info, [](const string&, const LogMetaData&) {});
+
+    for (auto source : { Logger::ClockSource::precise, Logger::ClockSource::coarse, Logger::ClockSource::tsc }) {
+        Logger::SetClockSource(source);
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            LOG(info) << "";
+        }
+        const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        cout << "clock source " << static_cast<int>(Logger::GetClockSource()) << ": " << elapsed.count() / iterations << " ns per line" << endl;
+    }
+
+    Logger::RemoveCustomSink("bench");
+    return 0;
+}
@@ -0,0 +1,63 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+// Cost of a suppressed LOG call, alone and while another thread keeps changing the thresholds
+
+#include <Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace fair;
+
+double SuppressedNsPerCall(int threads, int iterations)
+{
+    vector<thread> workers;
+    atomic<long> totalNs(0);
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            const auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                LOG(debug) << "suppressed " << i << " " << t;
+            }
+            totalNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    return static_cast<double>(totalNs.load()) / threads / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+    const int threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    Logger::SetConsoleSeverity(Severity::warn);
+
+    cout << "suppressed LOG, " << threads << " threads: " << SuppressedNsPerCall(threads, iterations) << " ns per call" << endl;
+
+    atomic<bool> stop(false);
+    thread reconfigure([&]() {
+        while (!stop) {
+            Logger::SetConsoleSeverity(Severity::error);
+            Logger::SetConsoleSeverity(Severity::warn);
+        }
+    });
+    cout << "suppressed LOG, " << threads << " threads, concurrent reconfiguration: " << SuppressedNsPerCall(threads, iterations) << " ns per call" << endl;
+    stop = true;
+    reconfigure.join();
+
+    return 0;
+}
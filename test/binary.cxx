@@ -0,0 +1,109 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#include "Common.h"
+#include <Logger.h>
+
+#include <cstdint>
+#include <cstdio> // popen
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace fair;
+using namespace fair::logger::test;
+
+string ReadFile(const string& name)
+{
+    ifstream t(name);
+    stringstream buffer;
+    buffer << t.rdbuf();
+    return buffer.str();
+}
+
+string Run(const string& cmd)
+{
+    string output;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) {
+        throw runtime_error(ToStr("could not run ", cmd));
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        output.append(buf, n);
+    }
+    if (pclose(pipe) != 0) {
+        throw runtime_error(ToStr("command failed: ", cmd));
+    }
+    return output;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cout << "usage: binaryTest <path to fairlogger-decode>" << endl;
+        return 1;
+    }
+
+    try {
+        Logger::SetConsoleColor(false);
+        Logger::SetConsoleSeverity(Severity::nolog);
+        Logger::SetVerbosity(Verbosity::veryhigh);
+
+        random_device rd;
+        mt19937 gen(rd());
+        uniform_int_distribution<> distrib(1, 65536);
+        const string id = to_string(distrib(gen));
+        string textName = Logger::InitFileSink(Severity::debug, "test_binary_text_" + id, true);
+        string binaryName = Logger::InitBinaryFileSink(Severity::debug, "test_binary_bin_" + id, true);
+
+        if (Logger::GetBinaryFileSeverity() != Severity::debug) {
+            throw runtime_error(ToStr("Binary file sink severity (", Logger::GetBinaryFileSeverity(), ") does not match the expected one (", Severity::debug, ")"));
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            LOG(info) << "streamed line " << i;
+            LOG(trace) << "not logged";
+            LOGPA(warn, "deferred {} {:.2f} {} {} '{}' {}", i, 0.25 * i, -7 * i, string("str"), 'c', true);
+            LOGFA(error, "printf %d %s %5.1f", i, "abc", 1.5f);
+            LOGPA(debug, "mixed {}", static_cast<uint8_t>(200)) << " and streamed";
+        }
+        LOGD(Severity::info, "custom.cxx", "42", "custom") << "custom origin";
+        // the decoder restores the width of integers: -1 of an int is ffffffff, not ffffffffffffffff
+        LOGFA(info, "hex %x %x %hx", -1, 255u, static_cast<short>(-2));
+
+        // lines below error are buffered until Flush()
+        Logger::Flush();
+        const string flushed = Run(string(argv[1]) + " " + binaryName);
+        const string last = "hex ffffffff ff fffe\n";
+        if (flushed.size() < last.size() || flushed.compare(flushed.size() - last.size(), last.size(), last) != 0) {
+            throw runtime_error(ToStr("expected the buffered lines in the binary file after Flush():\n", flushed));
+        }
+
+        Logger::RemoveFileSink();
+        Logger::RemoveBinaryFileSink();
+
+        string text = ReadFile(textName);
+        string decoded = Run(string(argv[1]) + " -j 2 " + binaryName);
+        remove(textName.c_str());
+        remove(binaryName.c_str());
+
+        if (decoded != text) {
+            throw runtime_error(ToStr("decoded binary log does not match the text log.\n##### text:\n", text, "##### decoded:\n", decoded));
+        }
+    } catch (runtime_error& rte) {
+        cout << rte.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#include "Common.h"
+#include <Logger.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace fair;
+using namespace fair::logger::test;
+
+void Quiet()
+{
+    LOG(debug) << "quiet debug";
+}
+
+void Noisy()
+{
+    LOG(error) << "noisy error";
+}
+
+Logger::CallSiteInfo FindSite(const string& function)
+{
+    auto sites = Logger::GetCallSites();
+    auto it = find_if(sites.begin(), sites.end(), [&](const Logger::CallSiteInfo& site) { return site.function == function; });
+    if (it == sites.end()) {
+        throw runtime_error(ToStr("call site in ", function, " is not registered"));
+    }
+    return *it;
+}
+
+int main()
+{
+#ifdef FAIR_MIN_SEVERITY
+    if (static_cast<int>(Severity::FAIR_MIN_SEVERITY) > static_cast<int>(Severity::debug)) {
+        cout << "test requires at least FAIR_MIN_SEVERITY == debug to run, skipping" << endl;
+        return 0;
+    }
+#endif
+
+    try {
+        Logger::SetConsoleColor(false);
+        Logger::SetConsoleSeverity(Severity::info);
+        Logger::SetVerbosity(Verbosity::low);
+
+        cout << "##### sites are registered when reached and follow the severity by default" << endl;
+        CheckOutput("^\\[ERROR\\] noisy error\n$", []() { Quiet(); Noisy(); });
+        if (FindSite("Quiet").state != CallSite::State::severity || FindSite("Noisy").state != CallSite::State::severity) {
+            throw runtime_error("expected both sites to follow the severity thresholds");
+        }
+        if (FindSite("Quiet").file != "callsites.cxx" || FindSite("Quiet").line != 22) {
+            throw runtime_error(ToStr("unexpected location of the site in Quiet: ", FindSite("Quiet").file, ":", FindSite("Quiet").line));
+        }
+
+        cout << "##### enabling a site below the console severity" << endl;
+        if (Logger::EnableCallSites("call*.cxx", "Quiet") != 1) {
+            throw runtime_error("expected EnableCallSites to match exactly one site");
+        }
+        CheckOutput("^\\[DEBUG\\] quiet debug\n\\[ERROR\\] noisy error\n$", []() { Quiet(); Noisy(); });
+
+        cout << "##### disabling a site by line range" << endl;
+        Logger::DisableCallSites("*", "*", 27, 27);
+        CheckOutput("^\\[DEBUG\\] quiet debug\n$", []() { Quiet(); Noisy(); });
+        if (FindSite("Noisy").state != CallSite::State::disabled || FindSite("Quiet").state != CallSite::State::enabled) {
+            throw runtime_error("unexpected site states after disabling");
+        }
+
+        cout << "##### rules apply to sites reached later" << endl;
+        Logger::DisableCallSites("callsites.cxx", "*", __LINE__ + 1, __LINE__ + 1);
+        CheckOutput("^$", []() { LOG(warn) << "disabled before first use"; });
+
+        cout << "##### fatal lines are always written" << endl;
+        CheckOutput("^\\[FATAL\\] fatal\n$", []() { LOG(fatal) << "fatal"; });
+
+        cout << "##### resetting" << endl;
+        Logger::ResetCallSites();
+        CheckOutput("^\\[ERROR\\] noisy error\n\\[WARN\\] enabled again\n$", []() { Quiet(); Noisy(); LOG(warn) << "enabled again"; });
+    } catch (runtime_error& rte) {
+        cout << rte.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
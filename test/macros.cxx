@@ -9,7 +9,14 @@
 #include "Common.h"
 #include <Logger.h>
 
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
 
 using namespace std;
 using namespace fair;
@@ -34,11 +41,65 @@ int main()
             throw runtime_error(ToStr("expected x to be 1, but it is: ", x));
         }
 
+        // the stream of a skipped occurrence is not evaluated
+        x = 0;
+        CheckOutput("^line 1\nline 2 \\[2 suppressed\\]\nline 3 \\[2 suppressed\\]\n$", [&]() {
+            for (int i = 0; i < 7; ++i) {
+                LOG_EVERY_N(fatal, 3) << "line " << ++x;
+            }
+        });
+        if (x != 3) {
+            throw runtime_error(ToStr("expected x to be 3, but it is: ", x));
+        }
+
+        CheckOutput("^line 1\nline 2\n$", []() {
+            for (int i = 1; i <= 5; ++i) {
+                LOG_FIRST_N(fatal, 2) << "line " << i;
+            }
+        });
+
+        CheckOutput("^line 1\n$", []() {
+            for (int i = 1; i <= 5; ++i) {
+                LOG_EVERY_T(fatal, 3600) << "line " << i;
+            }
+        });
+        CheckOutput("^line 1\nline 3 \\[1 suppressed\\]\n$", []() {
+            for (int i = 1; i <= 3; ++i) {
+                LOG_EVERY_T(fatal, 0.05) << "line " << i;
+                if (i == 2) {
+                    this_thread::sleep_for(chrono::milliseconds(100));
+                }
+            }
+        });
+
+        // a site of a disabled severity does not count
+        CheckOutput("^$", []() {
+            for (int i = 0; i < 3; ++i) {
+                LOG_FIRST_N(info, 1) << "not logged";
+            }
+        });
+
         CheckOutput("^Hello world :-\\)!\n$", []() { LOGP(fatal, "Hello {} {}!", "world", ":-)"); });
         CheckOutput("^Hello world :-\\)!\n$", []() { LOGF(fatal, "Hello %s %s!", "world", ":-)"); });
 
+        string world("world");
+        CheckOutput("^Hello world 42 1.5 true!\n$", [&]() { LOGPA(fatal, "Hello {} {} {} {}!", world, 42, 1.5, true); });
+        CheckOutput("^Hello world 42!\n$", [&]() { LOGFA(fatal, "Hello %s %d!", world.c_str(), 42); });
+        CheckOutput("^Hello world! and more\n$", []() { LOGPA(fatal, "Hello {}!", "world") << " and more"; });
+
         CheckOutput(ToStr(R"(^\[FATAL\])", " content\n$"), []() { LOGV(fatal, low) << "content"; });
 
+        // streamed values must look exactly like they do with std::ostream
+#define STREAM_VALUES(os) \
+    os << 'c' << ' ' << true << ' ' << static_cast<unsigned char>('u') << ' ' << -42 << ' ' << 18446744073709551615ULL << ' ' \
+       << 1.5 << ' ' << 0.1f << ' ' << 1e20 << ' ' << 3.14159265358979 << ' ' << string("str") << ' ' << string_view("sv") << ' ' \
+       << Severity::warn << ' ' << hex << 255 << ' ' << setw(4) << setfill('0') << 7 << ' ' << 1.5
+        ostringstream expected;
+        STREAM_VALUES(expected);
+        string pattern = regex_replace(expected.str(), regex(R"([.+])"), R"(\$&)");
+        CheckOutput(ToStr("^", pattern, "\n$"), []() { STREAM_VALUES(LOGV(fatal, verylow)); });
+#undef STREAM_VALUES
+
         CheckOutput("^\n\n\n\n$", []() {
             LOGN(fatal);
             LOGN(fatal);
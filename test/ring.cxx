@@ -0,0 +1,145 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#include "Common.h"
+#include <Logger.h>
+
+#include <csignal>
+#include <cstdio> // popen
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h> // fork
+
+using namespace std;
+using namespace fair;
+using namespace fair::logger::test;
+
+vector<string> Extract(const string& tool, const string& file)
+{
+    const string cmd = tool + " " + file + " 2>/dev/null";
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) {
+        throw runtime_error(ToStr("could not run ", cmd));
+    }
+    string output;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        output.append(buf, n);
+    }
+    if (pclose(pipe) != 0) {
+        throw runtime_error(ToStr("command failed: ", cmd));
+    }
+    vector<string> lines;
+    istringstream stream(output);
+    for (string line; getline(stream, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cout << "usage: ringTest <path to fairlogger-ring>" << endl;
+        return 1;
+    }
+    const string tool(argv[1]);
+
+    try {
+        Logger::SetConsoleColor(false);
+        Logger::SetConsoleSeverity(Severity::nolog);
+        Logger::SetVerbosity(Verbosity::low);
+
+        random_device rd;
+        mt19937 gen(rd());
+        uniform_int_distribution<> distrib(1, 65536);
+        const string id = to_string(distrib(gen));
+
+        cout << "##### wrapping" << endl;
+
+        const string ringName = Logger::InitRingFileSink(Severity::debug, "test_ring_" + id, 4096, true);
+        if (Logger::GetRingFileSeverity() != Severity::debug) {
+            throw runtime_error(ToStr("Ring file sink severity (", Logger::GetRingFileSeverity(), ") does not match the expected one (", Severity::debug, ")"));
+        }
+        for (int i = 0; i < 500; ++i) {
+            LOG(info) << "line " << i;
+            LOG(trace) << "not logged";
+        }
+        Logger::RemoveRingFileSink();
+
+        vector<string> lines = Extract(tool, ringName);
+        // 4096 bytes hold about 150 of the lines, always the newest ones
+        if (lines.size() < 100 || lines.size() >= 500) {
+            throw runtime_error(ToStr("unexpected number of lines in the ring: ", lines.size()));
+        }
+        for (size_t i = 0; i < lines.size(); ++i) {
+            const string expected = ToStr("[INFO] line ", 500 - lines.size() + i);
+            if (lines[i] != expected) {
+                throw runtime_error(ToStr("unexpected line ", i, " in the ring: '", lines[i], "', expected '", expected, "'"));
+            }
+        }
+
+        cout << "##### reopening" << endl;
+
+        Logger::InitRingFileSink(Severity::debug, ringName, 4096, false);
+        LOG(warn) << "after reopening";
+        Logger::RemoveRingFileSink();
+        lines = Extract(tool, ringName);
+        if (lines.size() < 2 || lines[lines.size() - 2] != "[INFO] line 499" || lines.back() != "[WARN] after reopening") {
+            throw runtime_error("expected the ring to be continued after reopening the file");
+        }
+        remove(ringName.c_str());
+
+        cout << "##### crash" << endl;
+
+        const string crashName = "test_ring_crash_" + id + ".ring";
+        pid_t pid = fork();
+        if (pid == 0) {
+            Logger::InitRingFileSink(Severity::debug, crashName, 4096, false);
+            for (int i = 0; i < 10; ++i) {
+                LOG(info) << "before crash " << i;
+            }
+            raise(SIGKILL);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFSIGNALED(status)) {
+            throw runtime_error("expected the child process to be killed");
+        }
+        lines = Extract(tool, crashName);
+        if (lines.size() != 10 || lines.back() != "[INFO] before crash 9") {
+            throw runtime_error(ToStr("expected the lines of the killed process to survive, found ", lines.size()));
+        }
+
+        cout << "##### corrupt record" << endl;
+
+        {
+            // the first record starts right after the 64 byte header and its own 8 byte length/checksum
+            fstream file(crashName, ios::in | ios::out | ios::binary);
+            file.seekp(64 + 8);
+            file.put('X');
+        }
+        lines = Extract(tool, crashName);
+        if (lines.size() != 9 || lines.front() != "[INFO] before crash 1") {
+            throw runtime_error(ToStr("expected the corrupt record to be skipped, found ", lines.size(), " lines"));
+        }
+        remove(crashName.c_str());
+    } catch (runtime_error& rte) {
+        cout << rte.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
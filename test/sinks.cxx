@@ -9,10 +9,22 @@
 #include "Common.h"
 #include <Logger.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <sstream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef FAIRLOGGER_WITH_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace std;
 using namespace fair;
@@ -142,6 +154,577 @@ int main()
         if (!caught) {
             throw runtime_error("expected to throw a runtime_error upon removing non-existent sink, but none was thrown");
         }
+
+        cout << "##### custom sink timestamps from every clock source" << endl;
+
+        for (auto source : { Logger::ClockSource::precise, Logger::ClockSource::coarse, Logger::ClockSource::tsc }) {
+            Logger::SetClockSource(source);
+            chrono::microseconds logged(0);
+            Logger::AddCustomSink("ClockSink", Severity::error, [&](const string& /*content*/, const LogMetaData& metadata) {
+                logged = chrono::seconds(metadata.timestamp) + metadata.us;
+            });
+            LOG(error) << "time";
+            Logger::RemoveCustomSink("ClockSink");
+            auto now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch());
+            if (now - logged > chrono::seconds(1) || logged - now > chrono::seconds(1)) {
+                throw runtime_error(ToStr("timestamp of clock source ", static_cast<int>(Logger::GetClockSource()), " is off by ", (now - logged).count(), " us"));
+            }
+        }
+        Logger::SetClockSource(Logger::ClockSource::precise);
+
+        cout << "##### custom sink with string_view content and extended metadata" << endl;
+
+        {
+            vector<ExtendedLogMetaData> received;
+            vector<string> contents;
+            Logger::AddCustomSink("ViewSink", Severity::error, [&](string_view content, const ExtendedLogMetaData& metadata) {
+                received.push_back(metadata);
+                contents.emplace_back(content);
+            });
+            const int line = __LINE__; LOG(error) << "first"; LOG(warn) << "skipped"; LOG(error) << "second";
+            LOGD(Severity::error, "somefile.cxx", "42", "somefunction") << "third";
+            Logger::RemoveCustomSink("ViewSink");
+
+            if (contents != vector<string>{ "first", "second", "third" }) {
+                throw runtime_error(ToStr("unexpected content in string_view sink, got ", contents.size(), " lines"));
+            }
+            for (size_t i = 0; i < received.size(); ++i) {
+                if (received.at(i).thread_id != this_thread::get_id()) {
+                    throw runtime_error(ToStr("unexpected thread id in extended metadata of line ", i));
+                }
+                if (received.at(i).steady.count() == 0) {
+                    throw runtime_error(ToStr("steady timestamp not set in extended metadata of line ", i));
+                }
+                if (i > 0 && received.at(i).sequence <= received.at(i - 1).sequence) {
+                    throw runtime_error(ToStr("sequence numbers not increasing: ", received.at(i - 1).sequence, ", ", received.at(i).sequence));
+                }
+            }
+            if (received.at(0).line_number != line || received.at(1).line_number != line || received.at(2).line_number != 42) {
+                throw runtime_error(ToStr("unexpected line numbers: ", received.at(0).line_number, ", ", received.at(1).line_number, ", ", received.at(2).line_number));
+            }
+            if (received.at(0).severity != Severity::error || received.at(1).severity != Severity::error) {
+                throw runtime_error("unexpected severity in extended metadata");
+            }
+        }
+
+        cout << "##### batch sink" << endl;
+
+        {
+            mutex mtx;
+            vector<vector<string>> batches;
+            vector<string> files;
+            Logger::AddCustomBatchSink("BatchSink", Severity::error, 3, chrono::seconds(60), [&](const vector<CustomSinkRecord>& records) {
+                lock_guard<mutex> lock(mtx);
+                batches.emplace_back();
+                for (const auto& record : records) {
+                    batches.back().push_back(record.content);
+                    files.emplace_back(record.metadata.file);
+                }
+            });
+            for (int i = 0; i < 7; ++i) {
+                LOG(error) << i;
+            }
+            LOGD(Severity::error, "somefile.cxx", "42", "somefunction") << "7";
+            {
+                lock_guard<mutex> lock(mtx);
+                if (batches != vector<vector<string>>{ { "0", "1", "2" }, { "3", "4", "5" } }) {
+                    throw runtime_error(ToStr("expected two full batches before the flush, got ", batches.size()));
+                }
+            }
+            Logger::Flush();
+            {
+                lock_guard<mutex> lock(mtx);
+                if (batches.size() != 3 || batches.back() != vector<string>{ "6", "7" } || files.back() != "somefile.cxx") {
+                    throw runtime_error("expected the pending batch to be handed over by Flush()");
+                }
+                batches.clear();
+            }
+            LOG(error) << "before fatal";
+            LOG(fatal) << "fatal";
+            {
+                lock_guard<mutex> lock(mtx);
+                if (batches != vector<vector<string>>{ { "before fatal", "fatal" } }) {
+                    throw runtime_error("expected a fatal line to hand over the batch");
+                }
+            }
+            Logger::RemoveCustomSink("BatchSink");
+
+            batches.clear();
+            Logger::AddCustomBatchSink("TimedSink", Severity::error, 1000, chrono::milliseconds(20), [&](const vector<CustomSinkRecord>& records) {
+                lock_guard<mutex> lock(mtx);
+                batches.emplace_back();
+                for (const auto& record : records) {
+                    batches.back().push_back(record.content);
+                }
+            });
+            LOG(error) << "a";
+            LOG(error) << "b";
+            for (int i = 0; i < 500; ++i) {
+                {
+                    lock_guard<mutex> lock(mtx);
+                    if (!batches.empty()) {
+                        break;
+                    }
+                }
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+            {
+                lock_guard<mutex> lock(mtx);
+                if (batches != vector<vector<string>>{ { "a", "b" } }) {
+                    throw runtime_error(ToStr("expected the batch to be handed over after its delay, got ", batches.size(), " batches"));
+                }
+            }
+            LOG(error) << "c";
+            Logger::RemoveCustomSink("TimedSink");
+            if (batches.size() != 2 || batches.back() != vector<string>{ "c" }) {
+                throw runtime_error("expected the pending batch to be handed over on removal");
+            }
+        }
+
+        cout << "##### file sink with its own queue" << endl;
+
+        {
+            string queuedName = Logger::InitFileSink(Severity::warn, string("test_queued_log_" + to_string(distrib(gen))), true);
+            Logger::SetFileSinkQueue(64);
+            LOG(warn) << "warning";
+            LOG(error) << "error";
+            Logger::Flush();
+            ifstream queued(queuedName);
+            stringstream queuedBuffer;
+            queuedBuffer << queued.rdbuf();
+            if (queuedBuffer.str() != "[WARN] warning\n[ERROR] error\n") {
+                throw runtime_error(ToStr("unexpected output of the queued file sink:\n", queuedBuffer.str()));
+            }
+            if (Logger::GetFileSinkDrops() != 0) {
+                throw runtime_error("a blocking file sink queue is not expected to drop lines");
+            }
+            Logger::SetFileSinkQueue(0);
+            Logger::RemoveFileSink();
+        }
+
+        cout << "##### buffered file sink" << endl;
+
+        {
+            string bufferedName = Logger::InitFileSink(Severity::warn, string("test_buffered_log_" + to_string(distrib(gen))), true);
+            Logger::FlushPolicy policy;
+            policy.severity = Severity::error;
+            Logger::SetFileFlushPolicy(policy);
+            auto content = [&]() {
+                ifstream file(bufferedName);
+                stringstream fileBuffer;
+                fileBuffer << file.rdbuf();
+                return fileBuffer.str();
+            };
+            LOG(warn) << "one";
+            LOG(warn) << "two";
+            const string held = content();
+            LOG(error) << "three";
+            LOG(warn) << "four";
+            const string written = content();
+            Logger::Flush();
+            const string flushed = content();
+            if (!held.empty() || written != "[WARN] one\n[WARN] two\n[ERROR] three\n" || flushed != written + "[WARN] four\n") {
+                throw runtime_error(ToStr("unexpected buffered file output:\n", held, "---\n", written, "---\n", flushed));
+            }
+
+            policy.severity = Severity::fatal;
+            policy.interval = chrono::milliseconds(10);
+            Logger::SetFileFlushPolicy(policy);
+            // error and above are written right away, also below the policy severity
+            LOG(error) << "five";
+            if (content() != flushed + "[ERROR] five\n") {
+                throw runtime_error(ToStr("expected the error line to be written right away:\n", content()));
+            }
+            LOG(warn) << "six";
+            for (int i = 0; i < 500 && content() == flushed + "[ERROR] five\n"; ++i) {
+                this_thread::sleep_for(chrono::milliseconds(5));
+            }
+            if (content() != flushed + "[ERROR] five\n[WARN] six\n") {
+                throw runtime_error("expected the buffered line to be written out after the flush interval");
+            }
+            Logger::SetFileFlushPolicy(Logger::FlushPolicy());
+            Logger::RemoveFileSink();
+        }
+
+        cout << "##### file rotation" << endl;
+
+        {
+            const string rotatedName = "test_rotated_log_" + to_string(distrib(gen)) + ".log";
+            // rotated files left by an earlier run count towards keep
+            const vector<string> leftovers = { rotatedName + ".2001-01-01_00_00_00.1.gz", rotatedName + ".2001-01-01_00_00_00.2" };
+            for (const auto& f : leftovers) {
+                ofstream(f) << "old\n";
+            }
+            Logger::InitFileSink(Severity::warn, rotatedName, false);
+            Logger::RotationPolicy rotation;
+            rotation.maxBytes = 100;
+            rotation.keep = 2;
+            Logger::SetFileRotation(rotation);
+            for (int i = 0; i < 30; ++i) {
+                LOG(warn) << "line " << i; // 14-15 bytes each
+            }
+            auto rotatedFiles = [&]() {
+                vector<string> files;
+                for (const auto& entry : filesystem::directory_iterator(".")) {
+                    const string fileName = entry.path().filename().string();
+                    if (fileName.rfind(rotatedName + ".", 0) == 0) {
+                        files.push_back(fileName);
+                    }
+                }
+                return files;
+            };
+            // older files are pruned and compressed in the background
+            vector<string> files = rotatedFiles();
+            for (int i = 0; i < 500 && files.size() != 2; ++i) {
+                this_thread::sleep_for(chrono::milliseconds(5));
+                files = rotatedFiles();
+            }
+            if (files.size() != 2) {
+                throw runtime_error(ToStr("expected 2 rotated files to be kept, found ", files.size()));
+            }
+            for (const auto& f : leftovers) {
+                if (filesystem::exists(f)) {
+                    throw runtime_error(ToStr("expected the leftover rotated file ", f, " to be pruned"));
+                }
+            }
+            if (filesystem::file_size(rotatedName) > rotation.maxBytes) {
+                throw runtime_error(ToStr("current file exceeds the rotation size: ", filesystem::file_size(rotatedName)));
+            }
+#ifdef FAIRLOGGER_WITH_ZLIB
+            for (int i = 0; i < 500; ++i) {
+                files = rotatedFiles();
+                if (all_of(files.cbegin(), files.cend(), [](const string& f) { return f.size() > 3 && f.compare(f.size() - 3, 3, ".gz") == 0; })) {
+                    break;
+                }
+                this_thread::sleep_for(chrono::milliseconds(5));
+            }
+            for (const auto& f : files) {
+                ifstream gz(f, ios::binary);
+                if (gz.get() != 0x1f || gz.get() != 0x8b) {
+                    throw runtime_error(ToStr("expected rotated file ", f, " to be gzip compressed"));
+                }
+            }
+#endif
+            Logger::SetFileRotation(Logger::RotationPolicy());
+            Logger::RemoveFileSink();
+            remove(rotatedName.c_str());
+            for (const auto& f : rotatedFiles()) {
+                remove(f.c_str());
+            }
+        }
+
+#ifdef FAIRLOGGER_WITH_ZLIB
+        cout << "##### compressed file sink" << endl;
+
+        {
+            if (!Logger::SetFileCompression(true)) {
+                throw runtime_error("expected file compression to be available");
+            }
+            const string compressedName = Logger::InitFileSink(Severity::warn, string("test_compressed_log_" + to_string(distrib(gen))), true);
+            if (compressedName.compare(compressedName.size() - 7, 7, ".log.gz") != 0) {
+                throw runtime_error(ToStr("unexpected name of the compressed file: ", compressedName));
+            }
+            Logger::FlushPolicy policy;
+            policy.severity = Severity::error;
+            Logger::SetFileFlushPolicy(policy);
+            // reads all complete gzip members
+            auto content = [&]() {
+                string text;
+                gzFile gz = gzopen(compressedName.c_str(), "rb");
+                char chunk[256];
+                int n = 0;
+                while (gz && (n = gzread(gz, chunk, sizeof(chunk))) > 0) {
+                    text.append(chunk, n);
+                }
+                if (gz) {
+                    gzclose(gz);
+                }
+                return text;
+            };
+            LOG(warn) << "one";
+            LOG(warn) << "two";
+            LOG(error) << "three";
+            LOG(warn) << "four";
+            const string written = content();
+            Logger::Flush();
+            const string flushed = content();
+            if (written != "[WARN] one\n[WARN] two\n[ERROR] three\n" || flushed != written + "[WARN] four\n") {
+                throw runtime_error(ToStr("unexpected compressed file output:\n", written, "---\n", flushed));
+            }
+            Logger::SetFileFlushPolicy(Logger::FlushPolicy());
+
+            // without a buffering policy, many lines still share a frame
+            auto fileSize = [&]() { return static_cast<size_t>(ifstream(compressedName, ios::binary | ios::ate).tellg()); };
+            const size_t compressedBefore = fileSize();
+            string repetitive;
+            for (int i = 0; i < 1000; ++i) {
+                LOG(warn) << "a repetitive line";
+                repetitive += "[WARN] a repetitive line\n";
+            }
+            Logger::Flush();
+            const size_t compressedSize = fileSize() - compressedBefore;
+            if (content() != flushed + repetitive || compressedSize * 10 > repetitive.size()) {
+                throw runtime_error(ToStr("repetitive lines compressed from ", repetitive.size(), " to ", compressedSize, " bytes"));
+            }
+            Logger::RemoveFileSink();
+            Logger::SetFileCompression(false);
+            remove(compressedName.c_str());
+        }
+
+#endif
+        cout << "##### flight recorder" << endl;
+
+        Logger::SetConsoleSeverity(Severity::info);
+        Logger::SetFlightRecorder(Severity::debug, Severity::error, 2);
+        CheckOutput("^\\[INFO\\] one\n\\[DEBUG\\] two\n\\[DEBUG\\] three\n\\[DEBUG\\] thread\n\\[ERROR\\] four\n\\[ERROR\\] five\n$", []() {
+            LOG(debug) << "dropped"; // two lines per thread are kept
+            LOG(info) << "one";
+            LOG(debug) << "two";
+            LOG(trace) << "not recorded";
+            LOG(debug) << "three";
+            thread([]() { LOG(debug) << "thread"; }).join();
+            LOG(error) << "four";
+            LOG(error) << "five"; // nothing recorded since the last error
+        });
+        CheckOutput("^\\[DEBUG\\] six\n$", []() {
+            LOG(debug) << "six";
+            Logger::DumpFlightRecorder();
+        });
+        Logger::SetFlightRecorder(Severity::nolog);
+        CheckOutput("^\\[ERROR\\] seven\n$", []() {
+            LOG(debug) << "not recorded";
+            LOG(error) << "seven";
+        });
+
+        cout << "##### direct console output" << endl;
+
+        Logger::SetConsoleSeverity(Severity::info);
+        Logger::SetConsoleOutput(Logger::ConsoleOutput::direct);
+        CheckOutput("^\\[INFO\\] one\n\\[ERROR\\] two\n$", []() {
+            LOG(debug) << "zero";
+            LOG(info) << "one";
+            LOG(error) << "two";
+        });
+
+        {
+            // stdout is a regular file while captured, lines below error are held back until an error line or a flush
+            string held, written, flushed;
+            {
+                StreamCapturer<1> capture;
+                Logger::FlushPolicy policy;
+                policy.severity = Severity::error;
+                Logger::SetConsoleFlushPolicy(policy);
+                LOG(info) << "one";
+                LOG(info) << "two";
+                held = capture.GetCapture();
+                LOG(error) << "three";
+                LOG(info) << "four";
+                written = capture.GetCapture();
+                Logger::Flush();
+                flushed = capture.GetCapture();
+                Logger::SetConsoleFlushPolicy(Logger::FlushPolicy());
+            }
+            if (!held.empty() || written != "[INFO] one\n[INFO] two\n[ERROR] three\n" || flushed != written + "[INFO] four\n") {
+                throw runtime_error(ToStr("unexpected buffered console output:\n", held, "---\n", written, "---\n", flushed));
+            }
+        }
+        Logger::SetConsoleOutput(Logger::ConsoleOutput::stdio);
+
+        cout << "##### repeated lines" << endl;
+
+        Logger::SetConsoleRepeatSuppression(chrono::hours(1));
+        CheckOutput("^\\[INFO\\] same\n\\[INFO\\] last message repeated 4 times\n\\[INFO\\] other\n\\[INFO\\] same\n\\[INFO\\] same\n$", []() {
+            for (int i = 0; i < 5; ++i) {
+                LOG(info) << "same";
+            }
+            LOG(info) << "other";
+            // same content from another call site
+            LOG(info) << "same";
+            LOG(info) << "same";
+        });
+        CheckOutput("^\\[WARN\\] held\n\\[WARN\\] last message repeated 2 times\n$", []() {
+            for (int i = 0; i < 3; ++i) {
+                LOG(warn) << "held";
+            }
+            Logger::Flush();
+        });
+        Logger::SetConsoleRepeatSuppression(chrono::milliseconds(50));
+        CheckOutput("^\\[INFO\\] timeout\n\\[INFO\\] last message repeated 2 times\n\\[INFO\\] last message repeated 1 time\n$", []() {
+            for (int i = 0; i < 4; ++i) {
+                if (i == 3) {
+                    // no further line: the summary is written once the timeout has passed
+                    this_thread::sleep_for(chrono::milliseconds(300));
+                }
+                LOG(info) << "timeout";
+            }
+            Logger::Flush();
+        });
+        Logger::SetConsoleRepeatSuppression(chrono::milliseconds(0));
+        CheckOutput("^\\[INFO\\] again\n\\[INFO\\] again\n$", []() {
+            for (int i = 0; i < 2; ++i) {
+                LOG(info) << "again";
+            }
+        });
+        Logger::SetConsoleSeverity(Severity::nolog);
+
+        {
+            vector<string> received;
+            Logger::AddCustomSink("repeats", Severity::info, [&](string_view content, const ExtendedLogMetaData&) { received.emplace_back(content); });
+            Logger::SetCustomSinkRepeatSuppression("repeats", chrono::hours(1));
+            for (int i = 0; i < 3; ++i) {
+                LOG(info) << "same";
+            }
+            for (int i = 0; i < 2; ++i) {
+                LOG(info) << "other";
+            }
+            Logger::RemoveCustomSink("repeats");
+            const vector<string> expected{ "same", "last message repeated 2 times", "other", "last message repeated 1 time" };
+            if (received != expected) {
+                string lines;
+                for (const auto& line : received) {
+                    lines += line + "\n";
+                }
+                throw runtime_error(ToStr("unexpected lines of the custom sink with repeat suppression:\n", lines));
+            }
+        }
+
+        cout << "##### custom sinks change while a sink logs" << endl;
+        {
+            // the line logged by the sink goes to the binary file sink, which takes the global lock
+            const string binaryName = Logger::InitBinaryFileSink(Severity::info, string("test_binary_sink_log_" + to_string(distrib(gen))), true);
+            Logger::AddCustomSink("logging", Severity::warn, [](const string&, const LogMetaData&) { LOG(info) << "from the sink"; });
+            atomic<bool> done(false);
+            thread changer([&]() {
+                for (int i = 0; i < 200; ++i) {
+                    Logger::AddCustomSink("changing", Severity::warn, [](const string&, const LogMetaData&) {});
+                    Logger::RemoveCustomSink("changing");
+                }
+                done = true;
+            });
+            while (!done) {
+                LOG(warn) << "to the sink";
+            }
+            changer.join();
+            Logger::RemoveCustomSink("logging");
+            Logger::RemoveBinaryFileSink();
+            remove(binaryName.c_str());
+        }
+
+        cout << "##### throttle" << endl;
+
+        Logger::SetConsoleSeverity(Severity::debug);
+        {
+            // 10 lines per second, a burst of 10 lines, debug lines may use half of it
+            Logger::ThrottlePolicy policy;
+            policy.lines = 10;
+            policy.reportInterval = chrono::milliseconds(0);
+            Logger::SetThrottle(policy);
+            CheckOutput("^(\\[DEBUG\\] d\n){5}(\\[WARN\\] w\n){5}(\\[ERROR\\] e\n){3}$", []() {
+                for (int i = 0; i < 20; ++i) {
+                    LOG(debug) << "d";
+                }
+                for (int i = 0; i < 10; ++i) {
+                    LOG(warn) << "w";
+                }
+                for (int i = 0; i < 3; ++i) {
+                    LOG(error) << "e";
+                }
+            });
+            if (Logger::GetThrottleDrops(Severity::debug) != 15 || Logger::GetThrottleDrops(Severity::warn) != 5 || Logger::GetThrottleDrops(Severity::error) != 0) {
+                throw runtime_error(ToStr("unexpected number of throttled lines: ", Logger::GetThrottleDrops(Severity::debug), " debug, ", Logger::GetThrottleDrops(Severity::warn), " warn"));
+            }
+
+            policy.lines = 1;
+            policy.reportInterval = chrono::milliseconds(50);
+            Logger::SetThrottle(policy);
+            CheckOutput("^\\[DEBUG\\] a\n\\[WARN\\] Logger throttle dropped lines since the last report: 3 DEBUG, 1 WARN\n$", []() {
+                LOG(debug) << "a";
+                for (int i = 0; i < 3; ++i) {
+                    LOG(debug) << "b";
+                }
+                this_thread::sleep_for(chrono::milliseconds(60));
+                LOG(warn) << "c";
+            });
+
+            // only the byte budget runs out: the dropped long lines leave the line budget to the short ones
+            policy.lines = 10;
+            policy.bytes = 100;
+            policy.reportInterval = chrono::milliseconds(0);
+            Logger::SetThrottle(policy);
+            const uint64_t warnDrops = Logger::GetThrottleDrops(Severity::warn);
+            CheckOutput("^(\\[WARN\\] x{40}\n){2}(\\[WARN\\] w\n){8}$", []() {
+                for (int i = 0; i < 7; ++i) {
+                    LOG(warn) << string(40, 'x');
+                }
+                for (int i = 0; i < 10; ++i) {
+                    LOG(warn) << "w";
+                }
+            });
+            if (Logger::GetThrottleDrops(Severity::warn) - warnDrops != 7) {
+                throw runtime_error(ToStr("unexpected number of lines dropped by the byte budget: ", Logger::GetThrottleDrops(Severity::warn) - warnDrops));
+            }
+            Logger::SetThrottle(Logger::ThrottlePolicy());
+        }
+        Logger::SetConsoleSeverity(Severity::nolog);
+
+        cout << "##### statistics" << endl;
+
+        Logger::SetStats(true);
+        Logger::GetStats(true);
+        Logger::SetConsoleSeverity(Severity::info);
+        {
+            auto sinkStats = [](const Logger::Stats& stats, const string& sinkName) {
+                auto it = find_if(stats.sinks.begin(), stats.sinks.end(), [&](const Logger::Stats::Sink& sink) { return sink.name == sinkName; });
+                if (it == stats.sinks.end()) {
+                    throw runtime_error(ToStr("no statistics of the sink ", sinkName));
+                }
+                return *it;
+            };
+
+            Logger::AddCustomSink("stats", Severity::warn, [](string_view, const ExtendedLogMetaData&) {});
+            CheckOutput("^\\[INFO\\] one\n\\[WARN\\] two\n\\[INFO\\] thread\n$", []() {
+                LOG(info) << "one";
+                LOG(warn) << "two";
+                LOG(debug) << "not logged";
+                thread([]() { LOG(info) << "thread"; }).join();
+            });
+            Logger::Stats stats = Logger::GetStats();
+            if (stats.messages[static_cast<size_t>(Severity::info)] != 2 || stats.messages[static_cast<size_t>(Severity::warn)] != 1 || stats.messages[static_cast<size_t>(Severity::debug)] != 0) {
+                throw runtime_error("unexpected number of counted lines");
+            }
+            if (stats.bytes[static_cast<size_t>(Severity::info)] != 9) {
+                throw runtime_error(ToStr("unexpected number of counted bytes: ", stats.bytes[static_cast<size_t>(Severity::info)]));
+            }
+            if (sinkStats(stats, "console").writes != 3 || sinkStats(stats, "file").writes != 0 || sinkStats(stats, "stats").writes != 1) {
+                throw runtime_error(ToStr("unexpected number of writes: ", sinkStats(stats, "console").writes, " console, ", sinkStats(stats, "stats").writes, " custom"));
+            }
+
+            Logger::AddCustomSink("throwing", Severity::error, [](string_view, const ExtendedLogMetaData&) { throw runtime_error("sink failure"); });
+            try {
+                LOG(error) << "three";
+            } catch (runtime_error&) {
+            }
+            stats = Logger::GetStats(true);
+            if (sinkStats(stats, "throwing").writes != 1 || sinkStats(stats, "throwing").errors != 1) {
+                throw runtime_error("expected the exception of the custom sink to be counted");
+            }
+            uint64_t timed = 0;
+            for (uint64_t count : stats.logTime) {
+                timed += count;
+            }
+            if (timed != 4) {
+                throw runtime_error(ToStr("expected the time of 4 lines in the histogram, found ", timed));
+            }
+
+            stats = Logger::GetStats();
+            if (stats.messages[static_cast<size_t>(Severity::info)] != 0 || sinkStats(stats, "console").writes != 0 || sinkStats(stats, "throwing").errors != 0) {
+                throw runtime_error("expected the statistics to be reset");
+            }
+            Logger::RemoveCustomSink("throwing");
+            Logger::RemoveCustomSink("stats");
+        }
+        Logger::SetConsoleSeverity(Severity::nolog);
+        Logger::SetStats(false);
     } catch (runtime_error& rte) {
         cout << rte.what() << endl;
         return 1;
@@ -9,7 +9,10 @@
 #include "Common.h"
 #include <Logger.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -58,6 +61,120 @@ $)", []() {
         t3.join();
         t4.join();
         t5.join();
+
+        cout << "##### custom sinks can be added and removed while other threads log" << endl;
+        atomic<bool> stop(false);
+        atomic<long> permanentLines(0);
+        Logger::SetConsoleSeverity(Severity::nolog);
+        Logger::AddCustomSink("permanent", Severity::info, [&](const string&, const LogMetaData&) { ++permanentLines; });
+        vector<thread> loggers;
+        for (int t = 0; t < 4; ++t) {
+            loggers.emplace_back([&]() {
+                for (int i = 0; i < 2000; ++i) {
+                    LOG(info) << "line " << i;
+                }
+            });
+        }
+        thread reconfigure([&]() {
+            while (!stop) {
+                Logger::AddCustomSink("transient", Severity::debug, [](const string&, const LogMetaData&) {});
+                Logger::SetCustomSeverity("transient", Severity::warn);
+                Logger::RemoveCustomSink("transient");
+            }
+        });
+        for (auto& t : loggers) {
+            t.join();
+        }
+        stop = true;
+        reconfigure.join();
+        Logger::RemoveCustomSink("permanent");
+        if (permanentLines != 8000) {
+            throw runtime_error(ToStr("expected 8000 lines in the permanent sink, found ", permanentLines.load()));
+        }
+
+        cout << "##### a slow sink with its own queue delays neither the logging thread nor other sinks" << endl;
+        atomic<int> fastLines(0);
+        atomic<int> slowLines(0);
+        Logger::AddCustomSink("fast", Severity::info, [&](const string&, const LogMetaData&) { ++fastLines; });
+        Logger::AddCustomSink("slow", Severity::info, [&](const string&, const LogMetaData&) {
+            this_thread::sleep_for(chrono::milliseconds(20));
+            ++slowLines;
+        });
+        Logger::SetCustomSinkQueue("slow", 4, Logger::OverflowPolicy::drop_newest);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < 20; ++i) {
+            LOG(info) << "line " << i;
+        }
+        auto elapsed = chrono::steady_clock::now() - start;
+        if (elapsed > chrono::milliseconds(200)) {
+            throw runtime_error(ToStr("logging 20 lines took ", chrono::duration_cast<chrono::milliseconds>(elapsed).count(), " ms with a queued slow sink"));
+        }
+        if (fastLines != 20) {
+            throw runtime_error(ToStr("expected 20 lines in the fast sink, found ", fastLines.load()));
+        }
+        Logger::Flush();
+        const uint64_t drops = Logger::GetCustomSinkDrops("slow");
+        if (drops == 0 || slowLines + drops != 20) {
+            throw runtime_error(ToStr("expected the slow sink to drop lines, got ", slowLines.load(), " lines and ", drops, " drops"));
+        }
+
+        Logger::RemoveCustomSink("slow");
+
+        cout << "##### drop_oldest keeps the newest lines" << endl;
+        vector<string> received;
+        Logger::AddCustomSink("oldest", Severity::info, [&](const string& content, const LogMetaData&) {
+            this_thread::sleep_for(chrono::milliseconds(5));
+            received.push_back(content);
+        });
+        Logger::SetCustomSinkQueue("oldest", 2, Logger::OverflowPolicy::drop_oldest);
+        for (int i = 0; i < 10; ++i) {
+            LOG(info) << "line " << i;
+        }
+        Logger::Flush();
+        if (received.empty() || received.back() != "line 9" || Logger::GetCustomSinkDrops("oldest") == 0) {
+            throw runtime_error("expected drop_oldest to drop lines but keep the last one");
+        }
+        Logger::RemoveCustomSink("oldest");
+
+        cout << "##### a blocking queue drops nothing" << endl;
+        slowLines = 0;
+        Logger::AddCustomSink("blocking", Severity::info, [&](const string&, const LogMetaData&) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            ++slowLines;
+        });
+        Logger::SetCustomSinkQueue("blocking", 2, Logger::OverflowPolicy::block);
+        for (int i = 0; i < 10; ++i) {
+            LOG(info) << "line " << i;
+        }
+        Logger::Flush();
+        if (slowLines != 10 || Logger::GetCustomSinkDrops("blocking") != 0) {
+            throw runtime_error(ToStr("expected the blocking queue to deliver all 10 lines, got ", slowLines.load()));
+        }
+        Logger::RemoveCustomSink("blocking");
+        Logger::RemoveCustomSink("fast");
+
+        cout << "##### the clock source can be switched while other threads log" << endl;
+        atomic<long> clockLines(0);
+        Logger::AddCustomSink("clock", Severity::info, [&](const string&, const LogMetaData&) { ++clockLines; });
+        loggers.clear();
+        for (int t = 0; t < 4; ++t) {
+            loggers.emplace_back([&]() {
+                for (int i = 0; i < 2000; ++i) {
+                    LOG(info) << "line " << i;
+                }
+            });
+        }
+        Logger::SetClockSource(Logger::ClockSource::tsc);
+        Logger::SetClockSource(Logger::ClockSource::precise);
+        Logger::SetClockSource(Logger::ClockSource::tsc);
+        for (auto& t : loggers) {
+            t.join();
+        }
+        Logger::SetClockSource(Logger::ClockSource::precise);
+        Logger::RemoveCustomSink("clock");
+        if (clockLines != 8000) {
+            throw runtime_error(ToStr("expected 8000 lines in the clock sink, found ", clockLines.load()));
+        }
     } catch (runtime_error& rte) {
         cout << rte.what() << endl;
         return 1;
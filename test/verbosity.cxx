@@ -9,6 +9,9 @@
 #include "Common.h"
 #include <Logger.h>
 
+#include <chrono>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
 #include <string>
 
@@ -93,6 +96,33 @@ int main()
             "\\[\033\\[01;34m.*\033\\[0m:\033\\[01;33m\\d+\033\\[0m:\033\\[01;34m.*\033\\[0m\\]"
             " content\n"
             "$", []() { LOG(fatal) << "content"; });
+
+        // location blocks are cached per call site, the second line from the same site must be identical
+        Logger::SetConsoleColor(false);
+        Logger::DefineVerbosity(Verbosity::user3, VerbositySpec::Make(VerbositySpec::Info::file_line));
+        Logger::SetVerbosity(Verbosity::user3);
+        CheckOutput(ToStr(R"(^(\[verbosity\.cxx:)", __LINE__, R"(\] content\n){2}$)"), []() { for (int i = 0; i < 2; ++i) { LOG(fatal) << "content"; } });
+        CheckOutput("^\\[custom\\.cxx:42\\] content\n$", []() { LOGD(fair::Severity::fatal, "/some/path/custom.cxx", "42", "func") << "content"; });
+
+        // cached timestamp rendering matches strftime, also when the second changes or repeats
+        auto timeSpec = VerbositySpec::Make(VerbositySpec::Info::timestamp_us);
+        for (time_t t : { time_t(0), time_t(1700000000), time_t(1700000000), time_t(1700000001), time_t(1600000000 + 3600 * 13) }) {
+            for (long us : { 0L, 7L, 123456L, 999999L }) {
+                LogMetaData infos{};
+                infos.timestamp = t;
+                infos.us = chrono::microseconds(us);
+                fmt::memory_buffer out;
+                Logger::FormatPrefix(out, timeSpec, infos, false);
+                tm local{};
+                localtime_r(&t, &local);
+                char hms[16];
+                strftime(hms, sizeof(hms), "%H:%M:%S", &local);
+                string expected = ToStr("[", hms, ".", setw(6), setfill('0'), us, "] ");
+                if (string(out.data(), out.size()) != expected) {
+                    throw runtime_error(ToStr("timestamp mismatch: expected '", expected, "', found '", string(out.data(), out.size()), "'"));
+                }
+            }
+        }
     } catch (runtime_error& rte) {
         cout << rte.what() << endl;
         return 1;
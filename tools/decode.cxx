@@ -0,0 +1,308 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+// fairlogger-decode: turns binary log files (Logger::InitBinaryFileSink) back into text
+
+#include <BinaryFormat.h>
+#include <Logger.h>
+
+#include <fmt/args.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace fair;
+
+namespace
+{
+
+struct Site
+{
+    string_view file;
+    string_view line;
+    string_view func;
+    string_view format;
+    string_view types;
+};
+
+struct RecordRef
+{
+    const char* pos; // start of the record body, after the tag
+    const char* end;
+    int64_t timestamp; // µs since epoch
+};
+
+struct Options
+{
+    VerbositySpec spec = Logger::GetVerbositySpec(Verbosity::veryhigh);
+    bool colored = false;
+    unsigned jobs = max(1u, thread::hardware_concurrency());
+    vector<string> files;
+};
+
+void Usage()
+{
+    cout << "Usage: fairlogger-decode [options] <file>...\n"
+         << "Turns binary FairLogger files back into text (on stdout).\n\n"
+         << "  -v, --verbosity <name>  output layout: verylow, low, medium, high, veryhigh (default)\n"
+         << "  -c, --color             colored output\n"
+         << "  -j, --jobs <n>          number of threads used for formatting (default: number of cores)\n"
+         << "  -h, --help              print this help" << endl;
+}
+
+// integers are added with the width they were logged with (the size tag), as conversions like %x depend on it
+template<typename Store>
+void PushSigned(Store& store, int64_t value, char size)
+{
+    switch (size) {
+        case '1': store.push_back(static_cast<int8_t>(value)); break;
+        case '2': store.push_back(static_cast<int16_t>(value)); break;
+        case '4': store.push_back(static_cast<int32_t>(value)); break;
+        default: store.push_back(value); break;
+    }
+}
+
+template<typename Store>
+void PushUnsigned(Store& store, uint64_t value, char size)
+{
+    switch (size) {
+        case '1': store.push_back(static_cast<uint8_t>(value)); break;
+        case '2': store.push_back(static_cast<uint16_t>(value)); break;
+        case '4': store.push_back(static_cast<uint32_t>(value)); break;
+        default: store.push_back(value); break;
+    }
+}
+
+// reads the arguments of a record into a fmt argument store, as described by the site type tags
+template<typename Store>
+void DecodeArgs(binlog::Reader& reader, string_view types, Store& store)
+{
+    for (size_t i = 1; i + 1 < types.size(); i += 2) {
+        switch (types[i]) {
+            case 's': store.push_back(reader.GetString()); break;
+            case 'i': PushSigned(store, reader.GetSVarint(), types[i + 1]); break;
+            case 'u': PushUnsigned(store, reader.GetVarint(), types[i + 1]); break;
+            case 'p': store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(reader.GetVarint()))); break;
+            case 'b': store.push_back(reader.GetU8() != 0); break;
+            case 'c': store.push_back(static_cast<char>(reader.GetU8())); break;
+            case 'f': store.push_back(reader.GetRaw<float>()); break;
+            case 'd': store.push_back(reader.GetRaw<double>()); break;
+            default: throw runtime_error(fmt::format("unknown argument type '{}' in binary log", types[i]));
+        }
+    }
+}
+
+void Render(const RecordRef& ref, const vector<Site>& sites, string_view processName, const Options& options, fmt::memory_buffer& out)
+{
+    binlog::Reader reader(ref.pos, ref.end);
+    const Site& site = sites.at(reader.GetVarint());
+    reader.GetSVarint(); // timestamp delta, already resolved by the scan
+    Severity severity = static_cast<Severity>(reader.GetU8());
+
+    LogMetaData infos{};
+    infos.timestamp = static_cast<time_t>(ref.timestamp / 1000000);
+    infos.us = chrono::microseconds(ref.timestamp % 1000000);
+    infos.process_name = processName;
+    infos.file = site.file;
+    infos.line = site.line;
+    infos.func = site.func;
+    infos.severity = severity;
+    infos.severity_name = Logger::SeverityName(severity);
+
+    Logger::FormatPrefix(out, options.spec, infos, options.colored);
+
+    if (!site.types.empty()) {
+        try {
+            if (site.types[0] == '%') {
+                fmt::dynamic_format_arg_store<fmt::printf_context> store;
+                DecodeArgs(reader, site.types, store);
+                string str = fmt::vsprintf(fmt::string_view(site.format.data(), site.format.size()), store);
+                out.append(str.data(), str.data() + str.size());
+            } else {
+                fmt::dynamic_format_arg_store<fmt::format_context> store;
+                DecodeArgs(reader, site.types, store);
+                fmt::vformat_to(back_inserter(out), site.format, store);
+            }
+        } catch (const fmt::format_error& e) {
+            fmt::format_to(back_inserter(out), "[format error in \"{}\": {}]", site.format, e.what());
+        }
+    }
+
+    string_view content = reader.GetString();
+    out.append(content.data(), content.data() + content.size());
+    out.push_back('\n');
+}
+
+// renders the records on multiple threads, writes them in the original order
+void RenderAll(const vector<RecordRef>& records, const vector<Site>& sites, string_view processName, const Options& options)
+{
+    const size_t jobs = min<size_t>(options.jobs, max<size_t>(1, records.size() / 1024));
+    vector<fmt::memory_buffer> outputs(jobs);
+    vector<thread> threads;
+    const size_t chunk = (records.size() + jobs - 1) / jobs;
+
+    for (size_t j = 0; j < jobs; ++j) {
+        auto work = [&, j]() {
+            const size_t end = min(records.size(), (j + 1) * chunk);
+            for (size_t i = j * chunk; i < end; ++i) {
+                Render(records[i], sites, processName, options, outputs[j]);
+            }
+        };
+        if (j + 1 == jobs) {
+            work();
+        } else {
+            threads.emplace_back(work);
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const auto& out : outputs) {
+        fwrite(out.data(), 1, out.size(), stdout);
+    }
+}
+
+bool Decode(const string& filename, const Options& options)
+{
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "fairlogger-decode: cannot open " << filename << endl;
+        return false;
+    }
+    const string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    binlog::Reader reader(data.data(), data.data() + data.size());
+    string_view processName;
+    int64_t timestamp = 0;
+
+    try {
+        for (char c : binlog::Magic) {
+            if (static_cast<char>(reader.GetU8()) != c) {
+                cerr << "fairlogger-decode: " << filename << " is not a binary FairLogger file" << endl;
+                return false;
+            }
+        }
+        uint8_t version = reader.GetU8();
+        if (version != binlog::Version) {
+            cerr << "fairlogger-decode: " << filename << " has unsupported version " << static_cast<int>(version) << endl;
+            return false;
+        }
+        processName = reader.GetString();
+        timestamp = static_cast<int64_t>(reader.GetVarint());
+    } catch (const binlog::Truncated&) {
+        cerr << "fairlogger-decode: " << filename << " is truncated" << endl;
+        return false;
+    }
+
+    // The scan is sequential (site definitions and timestamp deltas depend on the preceding entries),
+    // the expensive formatting of the records is done in parallel, in windows to bound memory use.
+    constexpr size_t window = 1 << 16;
+    vector<Site> sites;
+    vector<RecordRef> records;
+    records.reserve(window);
+
+    try {
+        while (!reader.AtEnd()) {
+            auto entry = static_cast<binlog::Entry>(reader.GetU8());
+            if (entry == binlog::Entry::site) {
+                uint64_t id = reader.GetVarint();
+                Site site;
+                site.file = reader.GetString();
+                site.line = reader.GetString();
+                site.func = reader.GetString();
+                site.format = reader.GetString();
+                site.types = reader.GetString();
+                if (id >= sites.size()) {
+                    sites.resize(id + 1);
+                }
+                sites[id] = site;
+            } else if (entry == binlog::Entry::record) {
+                const char* pos = reader.Pos();
+                const Site& site = sites.at(reader.GetVarint());
+                timestamp += reader.GetSVarint();
+                reader.GetU8();
+                if (!site.types.empty()) {
+                    fmt::dynamic_format_arg_store<fmt::format_context> skipped;
+                    DecodeArgs(reader, site.types, skipped);
+                }
+                reader.GetString();
+                records.push_back({ pos, reader.Pos(), timestamp });
+                if (records.size() == window) {
+                    RenderAll(records, sites, processName, options);
+                    records.clear();
+                }
+            } else {
+                throw runtime_error(fmt::format("unknown entry type {}", static_cast<int>(entry)));
+            }
+        }
+    } catch (const binlog::Truncated&) {
+        cerr << "fairlogger-decode: " << filename << " ends with an incomplete record, ignoring it" << endl;
+    } catch (const exception& e) {
+        RenderAll(records, sites, processName, options);
+        cerr << "fairlogger-decode: " << filename << ": " << e.what() << endl;
+        return false;
+    }
+
+    RenderAll(records, sites, processName, options);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "-h" || arg == "--help") {
+            Usage();
+            return 0;
+        } else if ((arg == "-v" || arg == "--verbosity") && i + 1 < argc) {
+            auto it = Logger::fVerbosityMap.find(argv[++i]);
+            if (it == Logger::fVerbosityMap.end()) {
+                cerr << "fairlogger-decode: unknown verbosity '" << argv[i] << "'" << endl;
+                return 1;
+            }
+            options.spec = Logger::GetVerbositySpec(it->second);
+        } else if (arg == "-c" || arg == "--color") {
+            options.colored = true;
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            options.jobs = max(1, atoi(argv[++i]));
+        } else if (!arg.empty() && arg[0] == '-') {
+            Usage();
+            return 1;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+
+    if (options.files.empty()) {
+        Usage();
+        return 1;
+    }
+
+    bool ok = true;
+    for (const auto& file : options.files) {
+        ok = Decode(file, options) && ok;
+    }
+    fflush(stdout);
+
+    return ok ? 0 : 1;
+}
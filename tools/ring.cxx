@@ -0,0 +1,131 @@
+/********************************************************************************
+ * Copyright (C) 2014-2025 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+// fairlogger-ring: extracts the lines of ring files (Logger::InitRingFileSink), oldest first
+
+#include <RingFormat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace fair;
+
+namespace
+{
+
+void Usage()
+{
+    cout << "Usage: fairlogger-ring [options] <file>...\n"
+         << "Extracts the lines of FairLogger ring files in the order they were written (on stdout).\n\n"
+         << "  -h, --help              print this help" << endl;
+}
+
+bool Extract(const string& filename)
+{
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "fairlogger-ring: cannot open " << filename << endl;
+        return false;
+    }
+    const string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    ringlog::Header header{};
+    if (data.size() >= ringlog::HeaderSize) {
+        memcpy(&header, data.data(), sizeof(header));
+    }
+    if (memcmp(header.magic, ringlog::Magic, sizeof(ringlog::Magic)) != 0) {
+        cerr << "fairlogger-ring: " << filename << " is not a FairLogger ring file" << endl;
+        return false;
+    }
+    if (header.version != ringlog::Version) {
+        cerr << "fairlogger-ring: " << filename << " has unsupported version " << header.version << endl;
+        return false;
+    }
+    const uint64_t capacity = header.capacity;
+    if (capacity == 0 || data.size() < header.headerSize + capacity || header.tail > header.head || header.head - header.tail > capacity) {
+        cerr << "fairlogger-ring: " << filename << " has a corrupt header" << endl;
+        return false;
+    }
+
+    const char* ring = data.data() + header.headerSize;
+    size_t corrupt = 0;
+    string out;
+    uint64_t pos = header.tail;
+    while (pos < header.head) {
+        const uint64_t offset = pos % capacity;
+        if (offset + ringlog::RecordHeaderSize > capacity) {
+            pos += capacity - offset;
+            continue;
+        }
+        uint32_t length;
+        uint32_t checksum;
+        memcpy(&length, ring + offset, sizeof(length));
+        memcpy(&checksum, ring + offset + sizeof(length), sizeof(checksum));
+        if (length == ringlog::Wrap) {
+            pos += capacity - offset;
+            continue;
+        }
+        if (offset + ringlog::RecordHeaderSize + length > capacity || pos + ringlog::RecordHeaderSize + length > header.head) {
+            ++corrupt;
+            break; // the length itself is broken, the following records cannot be found
+        }
+        const char* text = ring + offset + ringlog::RecordHeaderSize;
+        if (ringlog::Crc32(text, length) == checksum) {
+            out.append(text, length);
+            out.push_back('\n');
+        } else {
+            ++corrupt;
+        }
+        pos += ringlog::RecordHeaderSize + length;
+    }
+
+    fwrite(out.data(), 1, out.size(), stdout);
+    if (corrupt > 0) {
+        cerr << "fairlogger-ring: " << filename << ": skipped " << corrupt << " corrupt record(s)" << endl;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    vector<string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "-h" || arg == "--help") {
+            Usage();
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            Usage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        Usage();
+        return 1;
+    }
+
+    bool ok = true;
+    for (const auto& file : files) {
+        ok = Extract(file) && ok;
+    }
+    fflush(stdout);
+
+    return ok ? 0 : 1;
+}